@@ -0,0 +1,110 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+// a minimal benchmark harness, each case is a function timed over many iterations
+// until it has run for long enough to give a stable median
+namespace Benchmark
+{
+	struct Result
+	{
+		std::string	name;
+		size_t		entities	= 0;		// problem size, 0 when the case has none
+		size_t		items		= 1;		// units of work done by one iteration, for the per item time
+		size_t		iterations	= 0;
+		double		mean		= 0;		// nanoseconds per iteration
+		double		median		= 0;
+		double		min			= 0;
+		double		p99			= 0;
+		double		perItem		= 0;		// median / items
+	};
+
+	struct Options
+	{
+		double		minSeconds		= 0.5;	// per case, after the warmup
+		size_t		minIterations	= 5;
+		size_t		maxIterations	= 100000;
+		std::string	filter;					// only run cases whose name contains this
+	};
+
+	inline long long Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// times iteration() until the budget runs out, setup() runs untimed before every iteration
+	inline Result Run(const Options& options, const std::string& name, size_t entities, size_t items,
+		const std::function<void()>& iteration, const std::function<void()>& setup = nullptr)
+	{
+		Result result;
+		result.name		= name;
+		result.entities	= entities;
+		result.items	= std::max<size_t>(items, 1);
+
+		// one untimed pass to warm the caches and settle any lazy allocation
+		if (setup) { setup(); }
+		iteration();
+
+		std::vector<double> samples;
+		long long budget = (long long)(options.minSeconds * 1e9);
+		long long spent = 0;
+		while (samples.size() < options.maxIterations && (spent < budget || samples.size() < options.minIterations))
+		{
+			if (setup) { setup(); }
+
+			long long start = Now();
+			iteration();
+			long long duration = Now() - start;
+
+			samples.push_back((double)duration);
+			spent += duration;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		double sum = 0;
+		for (double sample : samples) { sum += sample; }
+
+		result.iterations	= samples.size();
+		result.mean			= sum / samples.size();
+		result.median		= samples[samples.size() / 2];
+		result.min			= samples.front();
+		result.p99			= samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+		result.perItem		= result.median / result.items;
+
+		std::printf("%-36s %8zu %8zu it %12.0f ns median %12.0f ns p99 %10.2f ns/item\n",
+			name.c_str(), entities, result.iterations, result.median, result.p99, result.perItem);
+		std::fflush(stdout);
+		return result;
+	}
+
+	inline bool WriteJson(const std::string& path, const std::vector<Result>& results)
+	{
+		std::ofstream out(path);
+		if (!out) { return false; }
+
+		out << "{\"benchmarks\":[";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const Result& r = results[i];
+			out << (i > 0 ? ",\n" : "\n");
+			out << "{\"name\":\"" << r.name << "\",";
+			out << "\"entities\":" << r.entities << ",";
+			out << "\"items\":" << r.items << ",";
+			out << "\"iterations\":" << r.iterations << ",";
+			out << "\"mean_ns\":" << r.mean << ",";
+			out << "\"median_ns\":" << r.median << ",";
+			out << "\"min_ns\":" << r.min << ",";
+			out << "\"p99_ns\":" << r.p99 << ",";
+			out << "\"ns_per_item\":" << r.perItem << "}";
+		}
+		out << "\n]}\n";
+		return true;
+	}
+}
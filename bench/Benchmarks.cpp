@@ -0,0 +1,440 @@
+/* Benchmarks for the ECS and physics core
+ *
+ * run from bin/ so the assets resolve, results are printed and optionally written as json:
+ *   SFMLGameBench [--out bench.json] [--filter name] [--time seconds]
+ */
+
+#include "Benchmark.h"
+
+#include "GameEngine.h"
+#include "Scene_Play.h"
+#include "EntityManager.h"
+#include "EntityMemoryPool.h"
+#include "Physics.h"
+#include "ParticleSystem.h"
+#include "ProjectilePool.h"
+#include "Tilemap.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+namespace
+{
+	const size_t Sizes[]	= { 1000, 10000, 100000 };
+	const size_t Bullets	= 32;
+
+	// a level with only a player in it, the bench scene fills the world itself
+	// so nothing is ever streamed in or out while it is being timed
+	const char* LevelPath	= "bench_level.txt";
+	const char* Level		= "Player 2 6 48 48 5 -20 20 0.75 Buster\n";
+
+	std::string Name(const char* name, size_t entities)
+	{
+		return std::string(name) + "/" + std::to_string(entities);
+	}
+
+	// Scene_Play filled with a level's worth of entities on top of ground and bullets
+	// the ground and clouds sit on the grid, so like a real level they are tiles of the map and only the cells
+	// in view cost anything. The entities are blocks and bushes placed half a cell off the grid, which a level
+	// keeps as entities, so every system really goes through that many
+	class BenchScene : public Scene_Play
+	{
+	public:
+
+		BenchScene(GameEngine* game, size_t entities)
+			: Scene_Play(game, LevelPath)
+		{
+			const Assets& assets = m_game->assets();
+			const Animation& ground = assets.getAnimation(assets.getAnimationHandle("Ground"));
+			const Animation& cloud	= assets.getAnimation(assets.getAnimationHandle("CloudSmall"));
+			const Animation& block	= assets.getAnimation(assets.getAnimationHandle("Block"));
+			const Animation& bush	= assets.getAnimation(assets.getAnimationHandle("Bush"));
+
+			spawnPlayer();
+
+			// nine blocks to every bush, the blocks two high on the ground from a few cells right of the player
+			size_t decorations	= entities / 10;
+			size_t blocks		= entities - decorations - 1;
+			const int first		= 4;
+
+			int columns = (int)std::max(blocks / 2, decorations) + first + 2;
+			m_tilemap.create(columns, 11, m_gridSize, height());
+			Tilemap::TypeId groundType	= m_tilemap.addType(ground);
+			Tilemap::TypeId cloudType	= m_tilemap.addType(cloud);
+			for (int column = 0; column < columns; column++)
+			{
+				for (int row = 0; row < 3; row++) { m_tilemap.set(LevelFile::Tile, column, row, groundType); }
+				if (column % 3 == 0) { m_tilemap.set(LevelFile::Decoration, column, 8 + column % 9 / 3, cloudType); }
+			}
+
+			auto offGrid = [this](float column, float row, const Animation& animation)
+			{
+				return Vec2((column * m_gridSize.x) + (animation.getSize().x / 2), height() - (row * m_gridSize.y) - (animation.getSize().y / 2));
+			};
+			for (size_t i = 0; i < blocks; i++)
+			{
+				Entity entity = m_entityManager.addEntity(Tag::tile);
+				entity.addComponent<CAnimation>(block, true);
+				entity.addComponent<CTransform>(offGrid(first + 0.5f + (float)(i / 2), (float)(3 + i % 2), block));
+				entity.addComponent<CBoundingBox>(block.getSize());
+				entity.addComponent<CDraggable>();
+			}
+			for (size_t i = 0; i < decorations; i++)
+			{
+				Entity entity = m_entityManager.addEntity(Tag::decoration);
+				entity.addComponent<CAnimation>(bush, true);
+				entity.addComponent<CTransform>(offGrid(first + 0.5f + (float)i, 5, bush));
+				entity.addComponent<CDraggable>();
+			}
+
+			// bullets fly well above the ground and live for the whole run, so every frame
+			// tests the same number of bullets against the tiles
+			const Vec2& bulletSize = m_game->assets().getAnimation(m_animations.weapon).getSize();
+			for (size_t i = 0; i < Bullets; i++)
+			{
+				Vec2 pos(i * m_gridSize.x + bulletSize.x / 2, height() - 6 * m_gridSize.y - bulletSize.y / 2);
+				m_projectiles.spawn(pos, Vec2(12, 0), 1 << 30);
+			}
+
+			m_entityManager.update();
+		}
+
+		void save(RewindBuffer::Frame& frame)			{ saveFrame(frame); }
+		void load(const RewindBuffer::Frame& frame)	{ loadFrame(frame); }
+	};
+
+	void BenchPool(const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t entities : Sizes)
+		{
+			std::vector<size_t> ids(entities);
+			EntityMemoryPool& pool = EntityMemoryPool::Instance();
+
+			results.push_back(Benchmark::Run(options, Name("pool_add_destroy", entities), entities, entities, [&]()
+			{
+				for (size_t i = 0; i < entities; i++) { ids[i] = pool.addEntity(Tag::tile).id(); }
+				for (size_t i = 0; i < entities; i++)
+				{
+					pool.destroyEntity(ids[i]);
+					pool.releaseEntity(ids[i]);
+				}
+			}));
+		}
+	}
+
+	void BenchSnapshot(const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t entities : Sizes)
+		{
+			EntityManager manager;
+			for (size_t i = 0; i < entities; i++)
+			{
+				Entity e = manager.addEntity(Tag::tile);
+				e.addComponent<CTransform>(Vec2((float)i, 0));
+				e.addComponent<CBoundingBox>(Vec2(64, 64));
+			}
+			manager.update();
+
+			EntityMemoryPool& pool = EntityMemoryPool::Instance();
+			EntityPoolSnapshot snapshot;
+			pool.snapshot(snapshot);
+
+			results.push_back(Benchmark::Run(options, Name("pool_snapshot", entities), entities, entities, [&]()
+			{
+				pool.snapshot(snapshot);
+			}));
+			results.push_back(Benchmark::Run(options, Name("pool_restore", entities), entities, entities, [&]()
+			{
+				pool.restore(snapshot);
+			}));
+
+			manager.clear();
+		}
+	}
+
+	void BenchEntityManager(const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t entities : Sizes)
+		{
+			size_t churn = std::max<size_t>(entities / 100, 1);
+
+			EntityManager manager;
+			for (size_t i = 0; i < entities; i++)
+			{
+				Tag tag = (i % 10 == 0) ? Tag::decoration : Tag::tile;
+				manager.addEntity(tag).addComponent<CTransform>(Vec2((float)i, 0));
+			}
+			manager.update();
+
+			// a typical frame, a percent of the world dies and is replaced before the update
+			results.push_back(Benchmark::Run(options, Name("entity_manager_update", entities), entities, entities, [&]()
+			{
+				const EntityVec& live = manager.getEntities();
+				for (size_t i = 0; i < churn; i++) { Entity e = live[i]; e.destroy(); }
+				for (size_t i = 0; i < churn; i++) { manager.addEntity(Tag::tile).addComponent<CTransform>(Vec2((float)i, 0)); }
+				manager.update();
+			}));
+
+			manager.clear();
+		}
+	}
+
+	void BenchOverlap(const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t entities : Sizes)
+		{
+
+			EntityManager manager;
+			for (size_t i = 0; i < entities; i++)
+			{
+				Entity e = manager.addEntity(Tag::tile);
+				e.addComponent<CTransform>(Vec2((float)(i % 1000) * 40, (float)(i / 1000) * 40));
+				e.addComponent<CBoundingBox>(Vec2(64, 64));
+			}
+			manager.update();
+
+			const EntityVec& all = manager.getEntities();
+			volatile float sink = 0;
+
+			// every entity against its neighbour, the same access pattern sCollision has
+			results.push_back(Benchmark::Run(options, Name("physics_get_overlap", entities), entities, entities, [&]()
+			{
+				float total = 0;
+				for (size_t i = 0; i < entities; i++)
+				{
+					Vec2 overlap = Physics::GetOverlap(all[i], all[(i + 1) % entities]);
+					total += overlap.x + overlap.y;
+				}
+				sink = total;
+			}));
+
+			manager.clear();
+		}
+	}
+
+	void BenchProjectiles(const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t bullets : Sizes)
+		{
+			// a thousand columns of ground three tiles deep, the bullets hang just above it all the way along
+			EntityManager manager;
+			for (size_t i = 0; i < 3000; i++)
+			{
+				Entity tile = manager.addEntity(Tag::tile);
+				tile.addComponent<CTransform>(Vec2((float)(i / 3) * 64 + 32, 736 - (float)(i % 3) * 64));
+				tile.addComponent<CBoundingBox>(Vec2(64, 64));
+			}
+			manager.update();
+
+			ProjectilePool pool(bullets);
+			pool.setShape(Vec2(32, 16), 64);
+			for (size_t i = 0; i < bullets; i++)
+			{
+				pool.spawn(Vec2((float)(i % 64000), 500 - (float)(i / 64000) * 20), Vec2(0, 0), 1 << 30);
+			}
+
+			// the ground is dragged off the map, so every tile is an entity and goes through the grid
+			Tilemap empty;
+			results.push_back(Benchmark::Run(options, Name("projectile_update", bullets), bullets, bullets, [&]()
+			{
+				pool.update(manager.getEntities(Tag::tile), empty);
+			}));
+
+			manager.clear();
+		}
+	}
+
+	// a box the size of the player walked along ground and blocks that cover the whole map
+	// both only touch the cells around the box or in view, so they are timed per call, the map size should not show
+	void BenchTilemap(GameEngine& game, const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		const Animation& ground = game.assets().getAnimation(game.assets().getAnimationHandle("Ground"));
+
+		for (size_t tiles : Sizes)
+		{
+			Tilemap map;
+			map.create((int)(tiles / 12), 12, Vec2(64, 64), 768);
+			Tilemap::TypeId type = map.addType(ground);
+			for (size_t i = 0; i < tiles; i++) { map.set(LevelFile::Tile, (int)(i / 12), (int)(i % 12), type); }
+
+			std::vector<Tilemap::Tile> found;
+			size_t step = 0;
+			volatile size_t sink = 0;
+			results.push_back(Benchmark::Run(options, Name("scene_play_tilemap_query", tiles), tiles, 1, [&]()
+			{
+				float x = (float)(step++ % (size_t)map.columns()) * 64;
+				map.query(Vec2(x, 384), Vec2(24 + 128, 24 + 128), found);
+				sink = found.size();
+			}));
+
+			// the view moves a cell every frame, so every draw builds the quads again like the frame a scrolling
+			// view crosses into the next column, a view that holds still only ever hits the cache
+			sf::View view = game.defaultView();
+			int scroll = std::max(map.columns() - (int)(view.getSize().x / 64), 1);
+			results.push_back(Benchmark::Run(options, Name("scene_play_tilemap_draw", tiles), tiles, 1, [&]()
+			{
+				view.setCenter(game.defaultView().getCenter().x + (float)(step % scroll) * 64, view.getCenter().y);
+				map.draw(&game, view, LevelFile::Tile, step++);
+			}));
+		}
+	}
+
+	void BenchScenePipeline(GameEngine& game, const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t entities : Sizes)
+		{
+			BenchScene scene(&game, entities);
+
+			// let the player land so every case times the same steady state
+			for (int i = 0; i < 60; i++) { scene.update(); }
+
+			results.push_back(Benchmark::Run(options, Name("scene_play_update", entities), entities, entities, [&]()
+			{
+				scene.update();
+			}));
+			results.push_back(Benchmark::Run(options, Name("scene_play_render", entities), entities, entities, [&]()
+			{
+				scene.sRender();
+			}));
+			results.push_back(Benchmark::Run(options, Name("scene_play_frame", entities), entities, entities, [&]()
+			{
+				scene.update();
+				scene.sRender();
+			}));
+		}
+	}
+
+	void BenchRewind(GameEngine& game, const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		for (size_t entities : Sizes)
+		{
+			BenchScene scene(&game, entities);
+			for (int i = 0; i < 60; i++) { scene.update(); }
+
+			RewindBuffer rewind(RewindBuffer::DefaultTicks, RewindBuffer::DefaultKeyframeInterval);
+			RewindBuffer::Frame frame;
+			size_t tick = 0;
+
+			// what a tick costs on top of scene_play_update when the history is on
+			results.push_back(Benchmark::Run(options, Name("scene_play_rewind_capture", entities), entities, entities, [&]()
+			{
+				scene.update();
+				scene.save(frame);
+				rewind.push(tick++, frame);
+			}));
+
+			// one step back while R is held, a tick half way between two keyframes
+			size_t target = rewind.newestTick() - RewindBuffer::DefaultKeyframeInterval / 2;
+			results.push_back(Benchmark::Run(options, Name("scene_play_rewind_restore", entities), entities, entities, [&]()
+			{
+				rewind.restore(target, frame);
+				scene.load(frame);
+			}));
+
+			std::printf("  history of %zu ticks at %zu entities: %.2f MB\n", rewind.tickCount(), entities, rewind.bytes() / (1024.0 * 1024.0));
+		}
+	}
+
+	// a steady stream of explosions, as many alive at once as there would be entities
+	void BenchParticles(GameEngine& game, const Benchmark::Options& options, std::vector<Benchmark::Result>& results)
+	{
+		const Animation& explosion = game.assets().getAnimation(game.assets().getAnimationHandle("Explosion"));
+		const size_t lifetime = (explosion.getFrameCount() - 1) * explosion.getSpeed();
+
+		for (size_t particles : Sizes)
+		{
+			if (particles > ParticleSystem::MaxParticles) { continue; }
+
+			// the same number spawns every tick as expires, the first run fills the system up to the size
+			ParticleSystem system;
+			size_t perTick = std::max<size_t>(particles / lifetime, 1);
+			auto tick = [&]()
+			{
+				for (size_t i = 0; i < perTick; i++)
+				{
+					system.emit(explosion, Vec2((float)(i % 64) * 20, (float)(i / 64 % 38) * 20), Vec2(0.5f, -0.5f));
+				}
+				system.update();
+			};
+			for (size_t i = 0; i < lifetime; i++) { tick(); }
+
+			results.push_back(Benchmark::Run(options, Name("scene_play_particles_update", particles), particles, particles, tick));
+			results.push_back(Benchmark::Run(options, Name("scene_play_particles_draw", particles), particles, particles, [&]()
+			{
+				system.draw(&game, game.defaultView());
+			}));
+		}
+	}
+
+	bool Selected(const Benchmark::Options& options, const char* group)
+	{
+		return options.filter.empty() || options.filter.find(group) != std::string::npos || std::string(group).find(options.filter) != std::string::npos;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Benchmark::Options options;
+	std::string out;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && std::strcmp(argv[i], "--out") == 0)			{ out = argv[++i]; }
+		else if (i + 1 < argc && std::strcmp(argv[i], "--filter") == 0)	{ options.filter = argv[++i]; }
+		else if (i + 1 < argc && std::strcmp(argv[i], "--time") == 0)	{ options.minSeconds = std::atof(argv[++i]); }
+		else
+		{
+			std::fprintf(stderr, "usage: SFMLGameBench [--out bench.json] [--filter name] [--time seconds]\n");
+			return 1;
+		}
+	}
+
+	std::vector<Benchmark::Result> results;
+
+	if (Selected(options, "pool_add_destroy"))		{ BenchPool(options, results); }
+	if (Selected(options, "pool_snapshot"))			{ BenchSnapshot(options, results); }
+	if (Selected(options, "entity_manager_update"))	{ BenchEntityManager(options, results); }
+	if (Selected(options, "physics_get_overlap"))	{ BenchOverlap(options, results); }
+	if (Selected(options, "projectile_update"))		{ BenchProjectiles(options, results); }
+
+	if (Selected(options, "scene_play"))
+	{
+		std::ifstream manifest("assets.txt");
+		if (!manifest)
+		{
+			std::fprintf(stderr, "assets.txt not found, run the benchmarks from bin/\n");
+			return 1;
+		}
+
+		{
+			std::ofstream level(LevelPath);
+			level << Level;
+		}
+
+		// the scene cases time the systems alone, the rewind cases add the history on top
+		RewindBuffer::Configure(0);
+
+		// the whole game minus the window, assets are decoded but never uploaded
+		GameEngine game("assets.txt", true);
+		game.waitForAssets();
+		BenchScenePipeline(game, options, results);
+		BenchRewind(game, options, results);
+		BenchParticles(game, options, results);
+		BenchTilemap(game, options, results);
+
+		std::remove(LevelPath);
+	}
+
+	if (!out.empty())
+	{
+		if (!Benchmark::WriteJson(out, results))
+		{
+			std::fprintf(stderr, "Could not write: %s\n", out.c_str());
+			return 1;
+		}
+		std::printf("Wrote %zu results to %s\n", results.size(), out.c_str());
+	}
+
+	return 0;
+}
@@ -5,21 +5,21 @@ Action::Action()
 
 }
 
-Action::Action(const std::string& name, Vec2 pos)
+Action::Action(ActionName name, Vec2 pos)
 	: m_name(name)
 	, m_pos(pos)
 {
 
 }
 
-Action::Action(const std::string& name, const std::string& type)
+Action::Action(ActionName name, ActionType type)
 	: m_name(name)
 	, m_type(type)
 {
 
 }
 
-Action::Action(const std::string& name, const std::string& type, Vec2 pos)
+Action::Action(ActionName name, ActionType type, Vec2 pos)
 	: m_name(name)
 	, m_type(type)
 	, m_pos(pos)
@@ -27,12 +27,12 @@ Action::Action(const std::string& name, const std::string& type, Vec2 pos)
 
 }
 
-const std::string& Action::name() const
+ActionName Action::name() const
 {
 	return m_name;
 }
 
-const std::string& Action::type() const
+ActionType Action::type() const
 {
 	return m_type;
 }
@@ -45,6 +45,31 @@ const Vec2& Action::pos() const
 std::string Action::toString() const
 {
 	std::stringstream ss;
-	ss << m_name << " " << m_type << " " << (int)m_pos.x << "," << (int)m_pos.y;
+	ss << NameString(m_name) << " " << TypeString(m_type) << " " << (int)m_pos.x << "," << (int)m_pos.y;
 	return ss.str();
 }
+
+const char* Action::NameString(ActionName name)
+{
+	// must stay in the same order as the ActionName enum
+	static const char* names[] =
+	{
+		"NONE", "UP", "DOWN", "LEFT", "RIGHT", "JUMP", "SHOOT", "PLAY", "PAUSE", "QUIT",
+		"TOGGLE_TEXTURE", "TOGGLE_COLLISION", "TOGGLE_GRID", "TOGGLE_HUD",
+		"LEFT_CLICK", "MIDDLE_CLICK", "RIGHT_CLICK", "MOUSE_MOVE",
+		"QUICKSAVE", "QUICKLOAD", "REWIND"
+	};
+	static_assert(sizeof(names) / sizeof(names[0]) == (size_t)ActionName::COUNT, "action name table out of date");
+
+	return names[(size_t)name];
+}
+
+const char* Action::TypeString(ActionType type)
+{
+	switch (type)
+	{
+		case ActionType::START: return "START";
+		case ActionType::END:	return "END";
+		default:				return "NONE";
+	}
+}
@@ -2,21 +2,53 @@
 
 #include "Common.h"
 
+// every action known to the engine, interned as a compact integer id
+// scenes bind keys to these ids and dispatch on them with a switch (jump table)
+enum class ActionName : unsigned char
+{
+	NONE,
+	UP,
+	DOWN,
+	LEFT,
+	RIGHT,
+	JUMP,
+	SHOOT,
+	PLAY,
+	PAUSE,
+	QUIT,
+	TOGGLE_TEXTURE,
+	TOGGLE_COLLISION,
+	TOGGLE_GRID,
+	TOGGLE_HUD,
+	LEFT_CLICK,
+	MIDDLE_CLICK,
+	RIGHT_CLICK,
+	MOUSE_MOVE,
+	QUICKSAVE,
+	QUICKLOAD,
+	REWIND,
+	COUNT
+};
+
+enum class ActionType : unsigned char { NONE, START, END };
+
 class Action
 {
-	std::string m_name	= "NONE";
-	std::string m_type	= "NONE"; // START/END 
+	ActionName	m_name	= ActionName::NONE;
+	ActionType	m_type	= ActionType::NONE;
 	Vec2		m_pos	= Vec2(0, 0);
 
 public:
 	Action();
-	Action(const std::string& name, Vec2 pos);
-	Action(const std::string& name, const std::string& type);
-	Action(const std::string& name, const std::string& type, Vec2 pos);
-	
+	Action(ActionName name, Vec2 pos);
+	Action(ActionName name, ActionType type);
+	Action(ActionName name, ActionType type, Vec2 pos);
 
-	const std::string& name() const;
-	const std::string& type() const;
+	ActionName name() const;
+	ActionType type() const;
 	const Vec2& pos() const;
 	std::string	toString() const;
-};
\ No newline at end of file
+
+	static const char* NameString(ActionName name);
+	static const char* TypeString(ActionType type);
+};
@@ -0,0 +1,47 @@
+#include "AllocationTracker.h"
+
+#include <cstdlib>
+#include <new>
+
+// the global operator new / delete, replaced only in builds that define TRACK_ALLOCATIONS
+// (cmake -DTRACK_ALLOCATIONS=ON), FrameBudgetTest always links them for --assert-zero-allocs
+#ifdef TRACK_ALLOCATIONS
+
+void* operator new(std::size_t size)
+{
+	AllocationTracker::OnAllocate(size);
+
+	void* memory = std::malloc(size == 0 ? 1 : size);
+	if (!memory) { throw std::bad_alloc(); }
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (!memory) { return; }
+
+	AllocationTracker::OnFree();
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	operator delete(memory);
+}
+
+#endif
@@ -0,0 +1,105 @@
+#include "AllocationTracker.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+void AllocationTracker::add(const char* scope, size_t size)
+{
+	m_frameCount++;
+	m_frameBytes += size;
+
+	const char* name = scope ? scope : "(no scope)";
+	size_t slot = (((size_t)name >> 3) * 0x9E3779B97F4A7C15ull) & (MaxScopes - 1);
+	for (size_t probe = 0; probe < MaxScopes; probe++, slot = (slot + 1) & (MaxScopes - 1))
+	{
+		ScopeAllocations& entry = m_scopes[slot];
+		if (entry.name == nullptr) { entry.name = name; }
+		if (entry.name == name)
+		{
+			entry.count++;
+			entry.bytes += size;
+			return;
+		}
+	}
+}
+
+void AllocationTracker::setMode(Mode mode)
+{
+	m_mode = mode;
+	m_scopes.fill(ScopeAllocations());
+	m_frameCount = m_frameBytes = m_frameFrees = 0;
+	m_growing = false;
+
+	t_tracker = mode == Off ? nullptr : this;
+	s_enabled.store(mode != Off, std::memory_order_relaxed);
+}
+
+AllocationTracker::Mode AllocationTracker::mode() const
+{
+	return m_mode;
+}
+
+void AllocationTracker::report()
+{
+	// the most allocations first, sorted on the stack
+	std::array<ScopeAllocations, MaxScopes> scopes;
+	size_t used = 0;
+	for (auto& entry : m_scopes)
+	{
+		if (entry.name) { scopes[used++] = entry; }
+	}
+
+	size_t count = std::min(used, ReportScopes);
+	std::partial_sort(scopes.begin(), scopes.begin() + count, scopes.begin() + used,
+		[](const ScopeAllocations& a, const ScopeAllocations& b) { return a.count > b.count; });
+
+	std::printf("frame %zu: %zu allocations, %zu bytes, %zu frees, %zu off thread%s\n",
+		m_frame, m_frameCount, m_frameBytes, m_frameFrees, s_otherThreads.exchange(0, std::memory_order_relaxed),
+		m_growing ? ", growing" : "");
+	for (size_t i = 0; i < count; i++)
+	{
+		std::printf("    %-32s %6zu  %8zu bytes\n", scopes[i].name, scopes[i].count, scopes[i].bytes);
+	}
+	std::fflush(stdout);
+}
+
+void AllocationTracker::endFrame()
+{
+	if (m_mode == Off) { return; }
+
+	t_ignore = true;
+	if (m_frameCount > 0)
+	{
+		report();
+
+		// counted rather than asserted so Release builds catch it too, see FrameBudgetTest --assert-zero-allocs
+		if (m_mode == AssertZero && !m_growing) { m_violations++; }
+	}
+
+	PROFILE_COUNTER("Allocations", m_frameCount);
+	PROFILE_COUNTER("Allocated Bytes", m_frameBytes);
+	t_ignore = false;
+
+	m_lastCount = m_frameCount;
+	m_lastBytes = m_frameBytes;
+	m_frameCount = m_frameBytes = m_frameFrees = 0;
+	m_growing = false;
+	m_scopes.fill(ScopeAllocations());
+	m_frame++;
+}
+
+size_t AllocationTracker::frameCount() const
+{
+	return m_lastCount;
+}
+
+size_t AllocationTracker::frameBytes() const
+{
+	return m_lastBytes;
+}
+
+size_t AllocationTracker::violations() const
+{
+	return m_violations;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// fed by the global operator new / delete in AllocationHooks.cpp, which are only replaced in builds
+// configured with -DTRACK_ALLOCATIONS=ON, and even then only count once tracking is switched on
+// with --track-allocations or Profiler::trackAllocations
+
+// counts heap allocations per frame, allocations on the thread that enabled tracking (the main thread)
+// are attributed to the innermost PROFILE_SCOPE, other threads are only counted in total
+// the hooks run inside operator new so nothing in here may allocate
+class AllocationTracker
+{
+public:
+
+	enum Mode { Off, Report, AssertZero };
+
+	static constexpr size_t MaxScopes		= 64;	// power of two
+	static constexpr size_t ReportScopes	= 5;
+
+	struct ScopeAllocations
+	{
+		const char*	name	= nullptr;
+		size_t		count	= 0;
+		size_t		bytes	= 0;
+	};
+
+private:
+
+	static inline std::atomic<bool>	s_enabled{ false };
+	static inline std::atomic<size_t>	s_otherThreads{ 0 };		// allocations made off the tracked thread
+	static inline thread_local AllocationTracker*	t_tracker = nullptr;
+	static inline thread_local const char*			t_scope = nullptr;
+	static inline thread_local bool					t_ignore = false;	// set while the report itself prints
+
+	std::array<ScopeAllocations, MaxScopes>	m_scopes;
+	size_t	m_frameCount	= 0;
+	size_t	m_frameBytes	= 0;
+	size_t	m_frameFrees	= 0;
+	size_t	m_lastCount		= 0;
+	size_t	m_lastBytes		= 0;
+	size_t	m_frame			= 0;
+	size_t	m_violations	= 0;
+	bool	m_growing		= false;	// the frame grew a buffer it keeps, see Growing
+	Mode	m_mode			= Off;
+
+	void add(const char* scope, size_t size);
+	void report();
+
+public:
+
+	static void OnAllocate(size_t size)
+	{
+		if (!s_enabled.load(std::memory_order_relaxed) || t_ignore) { return; }
+
+		if (t_tracker)	{ t_tracker->add(t_scope, size); }
+		else			{ s_otherThreads.fetch_add(1, std::memory_order_relaxed); }
+	}
+
+	static void OnFree()
+	{
+		if (t_tracker) { t_tracker->m_frameFrees++; }
+	}
+
+	// called by ProfileTimer so allocations know which scope they happened in
+	static const char* EnterScope(const char* name)
+	{
+		const char* parent = t_scope;
+		t_scope = name;
+		return parent;
+	}
+
+	static void LeaveScope(const char* parent)
+	{
+		t_scope = parent;
+	}
+
+	// a buffer kept from frame to frame had to grow, the frame is still reported but AssertZero lets it pass,
+	// it only happens until the buffer is big enough for the largest the level gets
+	static void Growing()
+	{
+		if (t_tracker) { t_tracker->m_growing = true; }
+	}
+
+	// makes room for size in a vector that is kept from frame to frame, with half as much again on top
+	// so a size creeping up reallocates now and then rather than every frame
+	template <typename Vector>
+	static void Reserve(Vector& values, size_t size)
+	{
+		if (size <= values.capacity()) { return; }
+		values.reserve(size + size / 2);
+		Growing();
+	}
+
+	// called from the thread whose frames are measured
+	void setMode(Mode mode);
+	Mode mode() const;
+	void endFrame();
+
+	// the last completed frame
+	size_t frameCount() const;
+	size_t frameBytes() const;
+	size_t violations() const;
+};
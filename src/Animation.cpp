@@ -1,5 +1,4 @@
 #include "Animation.h"
-#include <cmath>
 
 Animation::Animation()
 {
@@ -13,24 +12,20 @@ Animation::Animation(const std::string& name, const sf::Texture& t)
 }
 
 Animation::Animation(const std::string& name, const sf::Texture& t, size_t frameCount, size_t speed)
+	: Animation(name, t, t.getSize(), frameCount, speed)
+{
+
+}
+
+Animation::Animation(const std::string& name, const sf::Texture& t, sf::Vector2u textureSize, size_t frameCount, size_t speed)
 	: m_name		(name)
 	, m_sprite		(t)
 	, m_frameCount	(frameCount)
-	, m_currentFrame(0)
 	, m_speed		(speed)
 {
-	m_size = Vec2((float)t.getSize().x / frameCount, (float)t.getSize().y);
+	m_size = Vec2((float)textureSize.x / frameCount, (float)textureSize.y);
 	m_sprite.setOrigin(m_size.x / 2.0f, m_size.y / 2.0f);
-	m_sprite.setTextureRect(sf::IntRect(std::floor(m_currentFrame) * m_size.x, 0, m_size.x, m_size.y));
-}
-
-// updates the animation to show the next frame, depending on its speed
-// animation loops when it reaches the end
-void Animation::update()
-{
-	if (m_speed <= 0) return;
-	m_currentFrame++;
-	m_sprite.setTextureRect(sf::IntRect(((m_currentFrame / m_speed) % m_frameCount) * m_size.x, 0, m_size.x, m_size.y));
+	m_sprite.setTextureRect(sf::IntRect(0, 0, m_size.x, m_size.y));
 }
 
 const Vec2& Animation::getSize() const
@@ -43,12 +38,27 @@ const std::string& Animation::getName() const
 	return m_name;
 }
 
-sf::Sprite& Animation::getSprite()
+AnimationHandle Animation::getHandle() const
 {
-	return m_sprite;
+	return m_handle;
+}
+
+void Animation::setHandle(AnimationHandle handle)
+{
+	m_handle = handle;
+}
+
+size_t Animation::getFrameCount() const
+{
+	return m_frameCount;
 }
 
-bool Animation::hasEnded() const
+size_t Animation::getSpeed() const
 {
-	return m_currentFrame == (m_frameCount-1) * m_speed;
+	return m_speed;
+}
+
+const sf::Sprite& Animation::getSprite() const
+{
+	return m_sprite;
 }
\ No newline at end of file
@@ -1,26 +1,33 @@
 #pragma once
 
 #include "Common.h"
+#include "AssetHandle.h"
 #include <vector>
 
+// an animation as loaded by Assets, shared by every entity that plays it
+// the frame an entity is on lives in its CAnimation, so the component stays plain data
 class Animation
 {
-	sf::Sprite	m_sprite;
+	sf::Sprite	m_sprite;					// shows the first frame, entities pick their frame when drawn
 	size_t		m_frameCount	= 1;		// total number of frames of animation
-	size_t		m_currentFrame	= 0;		// the current frame of animation being played
 	size_t		m_speed			= 0;		// the speed to play this animation
 	Vec2		m_size			= { 1, 1 }; // size of the animation frame
 	std::string	m_name			= "none";
+	AnimationHandle m_handle;				// the slot this animation occupies in Assets
 
 public:
 
 	Animation();
 	Animation(const std::string& name, const sf::Texture& t);
 	Animation(const std::string& name, const sf::Texture& t, size_t frameCount, size_t speed);
+	// headless assets never upload their textures, so the size comes from the decoded image instead
+	Animation(const std::string& name, const sf::Texture& t, sf::Vector2u textureSize, size_t frameCount, size_t speed);
 
-	void update();
-	bool hasEnded() const;
 	const std::string& getName() const;
+	AnimationHandle getHandle() const;
+	void setHandle(AnimationHandle handle);
 	const Vec2& getSize() const;
-	sf::Sprite& getSprite();
+	size_t getFrameCount() const;
+	size_t getSpeed() const;
+	const sf::Sprite& getSprite() const;
 };
\ No newline at end of file
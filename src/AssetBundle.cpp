@@ -0,0 +1,183 @@
+#include "AssetBundle.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <SFML/Graphics.hpp>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+#include <future>
+
+std::vector<AssetBundle::ManifestEntry> AssetBundle::ReadManifest(const std::string& path)
+{
+	PROFILE_FUNCTION();
+	std::vector<ManifestEntry> entries;
+
+	std::ifstream file(path);
+	std::string str;
+	while (file >> str)
+	{
+		ManifestEntry entry;
+
+		if (str == "Texture")
+		{
+			entry.type = ManifestEntry::Texture;
+			file >> entry.name >> entry.source;
+		}
+		else if (str == "Animation")
+		{
+			entry.type = ManifestEntry::Animation;
+			file >> entry.name >> entry.source >> entry.frameCount >> entry.speed;
+		}
+		else if (str == "Font")
+		{
+			entry.type = ManifestEntry::Font;
+			file >> entry.name >> entry.source;
+		}
+		else
+		{
+			std::cerr << "Unknown Asset Type: " << str << std::endl;
+			continue;
+		}
+
+		entries.push_back(entry);
+	}
+
+	return entries;
+}
+
+bool AssetBundle::Build(const std::string& manifestPath, const std::string& bundlePath)
+{
+	PROFILE_FUNCTION();
+
+	std::vector<ManifestEntry> entries = ReadManifest(manifestPath);
+
+	std::vector<BundleTexture>		textures;
+	std::vector<BundleAnimation>	animations;
+	std::vector<BundleFont>			fonts;
+	std::vector<std::future<sf::Image>>	images;
+	std::vector<std::vector<char>>		fontData;
+	std::unordered_map<std::string, uint32_t> textureIndices;
+	std::string names;
+
+	auto addName = [&names](const std::string& name)
+	{
+		uint32_t offset = (uint32_t)names.size();
+		names += name;
+		names += '\0';
+		return offset;
+	};
+
+	// decode every image in parallel, the rest of the manifest is cheap
+	for (auto& entry : entries)
+	{
+		switch (entry.type)
+		{
+			case ManifestEntry::Texture:
+			{
+				textureIndices[entry.name] = (uint32_t)textures.size();
+				textures.push_back({ addName(entry.name), 0, 0, 1, 0 });
+
+				std::string path = entry.source;
+				images.push_back(ThreadPool::Instance().submit([path]()
+				{
+					sf::Image image;
+					if (!image.loadFromFile(path)) { std::cerr << "Could not load texture file: " << path << std::endl; }
+					return image;
+				}));
+				break;
+			}
+			case ManifestEntry::Animation:
+			{
+				auto it = textureIndices.find(entry.source);
+				if (it == textureIndices.end())
+				{
+					std::cerr << "Animation " << entry.name << " refers to unknown texture: " << entry.source << std::endl;
+					return false;
+				}
+				animations.push_back({ addName(entry.name), it->second, (uint32_t)entry.frameCount, (uint32_t)entry.speed });
+				break;
+			}
+			case ManifestEntry::Font:
+			{
+				std::ifstream file(entry.source, std::ios::binary);
+				if (!file)
+				{
+					std::cerr << "Could not load font file: " << entry.source << std::endl;
+					return false;
+				}
+				fontData.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				fonts.push_back({ addName(entry.name), 0, 0, (uint64_t)fontData.back().size() });
+				break;
+			}
+		}
+	}
+
+	auto align = [](uint64_t offset) { return (offset + 15) & ~uint64_t(15); };
+
+	// lay the file out: tables, then names, then the data blocks
+	BundleHeader header = {};
+	std::copy(Magic, Magic + 4, header.magic);
+	header.version			= Version;
+	header.textureCount		= (uint32_t)textures.size();
+	header.animationCount	= (uint32_t)animations.size();
+	header.fontCount		= (uint32_t)fonts.size();
+	header.nameTableSize	= (uint32_t)names.size();
+	header.nameTableOffset	= sizeof(BundleHeader)
+							+ textures.size()	* sizeof(BundleTexture)
+							+ animations.size() * sizeof(BundleAnimation)
+							+ fonts.size()		* sizeof(BundleFont);
+
+	std::vector<sf::Image> decoded;
+	uint64_t offset = align(header.nameTableOffset + names.size());
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		decoded.push_back(images[i].get());
+		if (decoded.back().getSize().x == 0) { return false; }
+
+		textures[i].width		= decoded.back().getSize().x;
+		textures[i].height		= decoded.back().getSize().y;
+		textures[i].pixelOffset = offset;
+		offset = align(offset + (uint64_t)textures[i].width * textures[i].height * 4);
+	}
+	for (auto& font : fonts)
+	{
+		font.dataOffset = offset;
+		offset = align(offset + font.dataSize);
+	}
+
+	std::ofstream out(bundlePath, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		std::cerr << "Could not write bundle: " << bundlePath << std::endl;
+		return false;
+	}
+
+	auto padTo = [&out](uint64_t position)
+	{
+		while ((uint64_t)out.tellp() < position) { out.put('\0'); }
+	};
+
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)textures.data(),	  textures.size()	* sizeof(BundleTexture));
+	out.write((const char*)animations.data(), animations.size() * sizeof(BundleAnimation));
+	out.write((const char*)fonts.data(),	  fonts.size()		* sizeof(BundleFont));
+	out.write(names.data(), names.size());
+
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		padTo(textures[i].pixelOffset);
+		out.write((const char*)decoded[i].getPixelsPtr(), (std::streamsize)textures[i].width * textures[i].height * 4);
+	}
+	for (size_t i = 0; i < fonts.size(); i++)
+	{
+		padTo(fonts[i].dataOffset);
+		out.write(fontData[i].data(), fontData[i].size());
+	}
+
+	std::cout << "Wrote bundle " << bundlePath << ": " << textures.size() << " textures, "
+			  << animations.size() << " animations, " << fonts.size() << " fonts, " << out.tellp() << " bytes" << std::endl;
+
+	return (bool)out;
+}
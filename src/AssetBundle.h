@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Binary asset bundle layout, every offset is in bytes from the start of the file
+//
+//   BundleHeader
+//   BundleTexture[textureCount]
+//   BundleAnimation[animationCount]
+//   BundleFont[fontCount]
+//   name table (null terminated strings, referenced by offset into the table)
+//   data blocks (RGBA8 pixels for each texture, raw font files), each 16 byte aligned
+//
+// the bundle is memory mapped at runtime, so textures are created straight from the mapped pixels
+namespace AssetBundle
+{
+	const char		Magic[4]	= { 'S', 'F', 'A', 'B' };
+	const uint32_t	Version		= 1;
+
+	struct BundleHeader
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	textureCount;
+		uint32_t	animationCount;
+		uint32_t	fontCount;
+		uint32_t	nameTableSize;
+		uint64_t	nameTableOffset;
+	};
+
+	struct BundleTexture
+	{
+		uint32_t	nameOffset;
+		uint32_t	width;
+		uint32_t	height;
+		uint32_t	smooth;
+		uint64_t	pixelOffset;	// width * height * 4 bytes of RGBA
+	};
+
+	struct BundleAnimation
+	{
+		uint32_t	nameOffset;
+		uint32_t	textureIndex;
+		uint32_t	frameCount;
+		uint32_t	speed;
+	};
+
+	struct BundleFont
+	{
+		uint32_t	nameOffset;
+		uint32_t	reserved;
+		uint64_t	dataOffset;
+		uint64_t	dataSize;
+	};
+
+	static_assert(sizeof(BundleHeader)	  == 32, "bundle layout must not depend on the compiler");
+	static_assert(sizeof(BundleTexture)	  == 24, "bundle layout must not depend on the compiler");
+	static_assert(sizeof(BundleAnimation) == 16, "bundle layout must not depend on the compiler");
+	static_assert(sizeof(BundleFont)	  == 24, "bundle layout must not depend on the compiler");
+
+	// one line of an assets.txt manifest
+	struct ManifestEntry
+	{
+		enum Type { Texture, Animation, Font };
+
+		Type		type;
+		std::string	name;
+		std::string	source;		// file path for textures and fonts, texture name for animations
+		size_t		frameCount	= 1;
+		size_t		speed		= 0;
+	};
+
+	std::vector<ManifestEntry> ReadManifest(const std::string& path);
+
+	// offline step: decode everything listed in the manifest and write it out as a single bundle
+	bool Build(const std::string& manifestPath, const std::string& bundlePath);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// a stable index into one of the Assets tables
+// resolve it once by name at load time, then every lookup through it is a plain array access
+template <typename T>
+struct AssetHandle
+{
+	static const size_t Invalid = (size_t)-1;
+
+	size_t index = Invalid;
+
+	AssetHandle() {}
+	explicit AssetHandle(size_t i) : index(i) {}
+
+	bool valid() const { return index != Invalid; }
+	bool operator == (const AssetHandle& rhs) const { return index == rhs.index; }
+	bool operator != (const AssetHandle& rhs) const { return index != rhs.index; }
+};
+
+namespace sf { class Texture; class Font; }
+class Animation;
+
+typedef AssetHandle<sf::Texture>	TextureHandle;
+typedef AssetHandle<Animation>		AnimationHandle;
+typedef AssetHandle<sf::Font>		FontHandle;
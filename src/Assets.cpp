@@ -1,101 +1,388 @@
 #include "Assets.h"
+#include "ThreadPool.h"
+#include "AssetBundle.h"
 #include <cassert>
+#include <cstring>
+
+namespace
+{
+	// true if [offset, offset + bytes) lies within a file of size bytes, without wrapping
+	bool InFile(uint64_t offset, uint64_t bytes, uint64_t size)
+	{
+		return offset <= size && bytes <= size - offset;
+	}
+
+	// every table, name, index and data block the loader will touch, checked before anything is registered
+	// so a bad or stale bundle fails as a whole and the engine can fall back to assets.txt
+	bool ValidBundle(const unsigned char* data, uint64_t size)
+	{
+		using namespace AssetBundle;
+
+		if (size < sizeof(BundleHeader)) { return false; }
+
+		const BundleHeader* header = (const BundleHeader*)data;
+		if (!std::equal(Magic, Magic + 4, header->magic) || header->version != Version) { return false; }
+
+		uint64_t tables = (uint64_t)header->textureCount * sizeof(BundleTexture)
+						+ (uint64_t)header->animationCount * sizeof(BundleAnimation)
+						+ (uint64_t)header->fontCount * sizeof(BundleFont);
+		if (!InFile(sizeof(BundleHeader), tables, size)) { return false; }
+		if (!InFile(header->nameTableOffset, header->nameTableSize, size)) { return false; }
+
+		const char* names = (const char*)(data + header->nameTableOffset);
+		auto validName = [&](uint32_t offset)
+		{
+			return offset < header->nameTableSize && std::memchr(names + offset, 0, header->nameTableSize - offset) != nullptr;
+		};
+
+		const BundleTexture*	textures	= (const BundleTexture*)(data + sizeof(BundleHeader));
+		const BundleAnimation*	animations	= (const BundleAnimation*)(textures + header->textureCount);
+		const BundleFont*		fonts		= (const BundleFont*)(animations + header->animationCount);
+
+		for (uint32_t i = 0; i < header->textureCount; i++)
+		{
+			const BundleTexture& t = textures[i];
+			if (!validName(t.nameOffset)) { return false; }
+			if (t.width > 0 && t.height > size / 4 / t.width) { return false; }
+			if (!InFile(t.pixelOffset, (uint64_t)t.width * t.height * 4, size)) { return false; }
+		}
+
+		for (uint32_t i = 0; i < header->animationCount; i++)
+		{
+			const BundleAnimation& a = animations[i];
+			if (!validName(a.nameOffset) || a.textureIndex >= header->textureCount) { return false; }
+		}
+
+		for (uint32_t i = 0; i < header->fontCount; i++)
+		{
+			const BundleFont& f = fonts[i];
+			if (!validName(f.nameOffset) || !InFile(f.dataOffset, f.dataSize, size)) { return false; }
+		}
+
+		return true;
+	}
+}
 
 Assets::Assets()
 {
 
 }
 
+Assets::~Assets()
+{
+	// decode jobs still reference our pending list, make sure none are left running
+	for (auto& pending : m_pendingTextures)
+	{
+		if (pending.image.valid()) { pending.image.wait(); }
+	}
+}
+
+void Assets::setHeadless(bool headless)
+{
+	m_headless = headless;
+}
+
 void Assets::loadFromFile(const std::string& path)
+{
+	loadFromFileAsync(path);
+	finishLoading();
+}
+
+void Assets::loadFromFileAsync(const std::string& path)
+{
+	PROFILE_FUNCTION();
+	for (auto& entry : AssetBundle::ReadManifest(path))
+	{
+		switch (entry.type)
+		{
+			case AssetBundle::ManifestEntry::Texture:	{ addTexture(entry.name, entry.source); break; }
+			case AssetBundle::ManifestEntry::Animation: { addAnimation(entry.name, entry.source, entry.frameCount, entry.speed); break; }
+			case AssetBundle::ManifestEntry::Font:		{ addFont(entry.name, entry.source); break; }
+		}
+	}
+}
+
+bool Assets::loadFromBundle(const std::string& path)
 {
 	PROFILE_FUNCTION();
-	std::ifstream file(path);
-	std::string str;
-	while (file.good())
+	using namespace AssetBundle;
+
+	if (!m_bundle.open(path))
 	{
-		file >> str;
+		std::cerr << "Could not open asset bundle: " << path << std::endl;
+		return false;
+	}
+
+	const unsigned char* data = m_bundle.data();
+	const BundleHeader* header = (const BundleHeader*)data;
 
-		if (str == "Texture")
+	if (!ValidBundle(data, m_bundle.size()))
+	{
+		std::cerr << "Not a valid asset bundle: " << path << std::endl;
+		m_bundle.close();
+		return false;
+	}
+
+	const BundleTexture*	textures	= (const BundleTexture*)(data + sizeof(BundleHeader));
+	const BundleAnimation*	animations	= (const BundleAnimation*)(textures + header->textureCount);
+	const BundleFont*		fonts		= (const BundleFont*)(animations + header->animationCount);
+	const char*				names		= (const char*)(data + header->nameTableOffset);
+
+	size_t textureBase = m_textures.size();
+	for (uint32_t i = 0; i < header->textureCount; i++)
+	{
+		PROFILE_SCOPE("Upload Bundled Texture");
+		const BundleTexture& t = textures[i];
+
+		// the pixels are already decoded, upload them straight out of the mapping
+		sf::Texture& texture = m_textures.emplace_back();
+		m_textureSizes.emplace_back(t.width, t.height);
+		if (!m_headless)
 		{
-			std::string name, path;
-			file >> name >> path;
-			addTexture(name, path);
+			texture.create(t.width, t.height);
+			texture.update(data + t.pixelOffset);
+			texture.setSmooth(t.smooth != 0);
 		}
-		else if (str == "Animation")
+		m_textureNames[names + t.nameOffset] = m_textures.size() - 1;
+	}
+
+	for (uint32_t i = 0; i < header->animationCount; i++)
+	{
+		const BundleAnimation& a = animations[i];
+
+		size_t texture = textureBase + a.textureIndex;
+		Animation animation(names + a.nameOffset, m_textures[texture], m_textureSizes[texture], a.frameCount, a.speed);
+		animation.setHandle(AnimationHandle(m_animations.size()));
+		m_animationNames[names + a.nameOffset] = m_animations.size();
+		m_animations.push_back(animation);
+	}
+
+	for (uint32_t i = 0; i < header->fontCount; i++)
+	{
+		const BundleFont& f = fonts[i];
+
+		// sf::Font reads from this memory for as long as it lives, the mapping stays open with us
+		sf::Font& font = m_fonts.emplace_back();
+		if (!font.loadFromMemory(data + f.dataOffset, (size_t)f.dataSize))
 		{
-			std::string name, texture;
-			size_t frames, speed;
-			file >> name >> texture >> frames >> speed;
-			addAnimation(name, texture, frames, speed);
+			std::cerr << "Could not load bundled font: " << names + f.nameOffset << std::endl;
+			m_fonts.pop_back();
+			continue;
 		}
-		else if (str == "Font")
+		m_fontNames[names + f.nameOffset] = m_fonts.size() - 1;
+	}
+
+	std::cout << "Loaded Bundle: " << path << " (" << header->textureCount << " textures, "
+			  << header->animationCount << " animations, " << header->fontCount << " fonts)" << std::endl;
+	return true;
+}
+
+void Assets::addTexture(const std::string& textureName, const std::string& path, bool smooth)
+{
+	PROFILE_FUNCTION();
+
+	// reserve the slot now so the handle can be resolved before the texture is uploaded
+	auto it = m_textureNames.find(textureName);
+	size_t index = (it != m_textureNames.end()) ? it->second : m_textures.size();
+	if (index == m_textures.size())
+	{
+		m_textures.emplace_back();
+		m_textureSizes.emplace_back();
+		m_textureNames[textureName] = index;
+	}
+
+	std::future<sf::Image> image = ThreadPool::Instance().submit([path]()
+	{
+		PROFILE_SCOPE_DYNAMIC("Decode " + path);
+		sf::Image image;
+		if (!image.loadFromFile(path))
 		{
-			std::string name, path;
-			file >> name >> path;
-			addFont(name, path);
+			std::cerr << "Could not load texture file: " << path << std::endl;
 		}
-		else
+		return image;
+	});
+
+	m_pendingTextures.push_back({ index, path, smooth, std::move(image) });
+	m_pendingTotal++;
+}
+
+void Assets::uploadTexture(PendingTexture& pending)
+{
+	PROFILE_SCOPE_DYNAMIC("Upload " + pending.path);
+
+	sf::Image image = pending.image.get();
+	sf::Texture& texture = m_textures[pending.index];
+
+	// a failed decode leaves an empty image, the texture stays empty just like a missing file did before
+	if (image.getSize().x == 0) { return; }
+
+	m_textureSizes[pending.index] = image.getSize();
+	if (m_headless) { return; }
+	if (!texture.loadFromImage(image)) { return; }
+
+	texture.setSmooth(pending.smooth);
+	std::cout << "Loaded Texture: " << pending.path << std::endl;
+}
+
+void Assets::update()
+{
+	if (isLoaded()) { return; }
+
+	PROFILE_FUNCTION();
+
+	// upload every image that is ready, leave the rest decoding
+	for (auto& pending : m_pendingTextures)
+	{
+		if (pending.image.valid() &&
+			pending.image.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
 		{
-			std::cerr << "Unknown Asset Type: " << str << std::endl;
+			uploadTexture(pending);
 		}
 	}
+
+	m_pendingTextures.erase(
+		std::remove_if(
+			m_pendingTextures.begin(),
+			m_pendingTextures.end(),
+			[](const PendingTexture& p) { return !p.image.valid(); }),
+		m_pendingTextures.end());
+
+	resolveAnimations();
 }
 
-void Assets::addTexture(const std::string& textureName, const std::string& path, bool smooth)
+void Assets::finishLoading()
 {
 	PROFILE_FUNCTION();
-	m_textureMap[textureName] = sf::Texture();
 
-	if (!m_textureMap[textureName].loadFromFile(path))
+	for (auto& pending : m_pendingTextures)
 	{
-		std::cerr << "Could not load texture file: " << path << std::endl;
-		m_textureMap.erase(textureName);
+		uploadTexture(pending);
 	}
-	else
+	m_pendingTextures.clear();
+
+	resolveAnimations();
+}
+
+void Assets::resolveAnimations()
+{
+	// build every animation whose texture is no longer pending
+	auto isTexturePending = [this](size_t textureIndex)
 	{
-		m_textureMap[textureName].setSmooth(smooth);
-		std::cout << "Loaded Texture: " << path << std::endl;
-	}
+		for (auto& pending : m_pendingTextures)
+		{
+			if (pending.index == textureIndex) { return true; }
+		}
+		return false;
+	};
+
+	m_pendingAnimations.erase(
+		std::remove_if(
+			m_pendingAnimations.begin(),
+			m_pendingAnimations.end(),
+			[&](const PendingAnimation& pending)
+			{
+				if (isTexturePending(pending.textureIndex)) { return false; }
+
+				Animation animation(pending.name, m_textures[pending.textureIndex], m_textureSizes[pending.textureIndex], pending.frameCount, pending.speed);
+				animation.setHandle(AnimationHandle(pending.index));
+				m_animations[pending.index] = animation;
+
+				std::cout << "Loaded Animation: " << pending.name << std::endl;
+				return true;
+			}),
+		m_pendingAnimations.end());
+}
+
+bool Assets::isLoaded() const
+{
+	return m_pendingTextures.empty() && m_pendingAnimations.empty();
+}
+
+size_t Assets::pendingCount() const
+{
+	return m_pendingTextures.size() + m_pendingAnimations.size();
+}
+
+size_t Assets::pendingTotal() const
+{
+	return m_pendingTotal;
+}
+
+TextureHandle Assets::getTextureHandle(const std::string& textureName) const
+{
+	auto it = m_textureNames.find(textureName);
+	assert(it != m_textureNames.end());
+	return it != m_textureNames.end() ? TextureHandle(it->second) : TextureHandle();
 }
 
 const sf::Texture& Assets::getTexture(const std::string& textureName) const
 {
-	assert(m_textureMap.find(textureName) != m_textureMap.end());
-	return m_textureMap.at(textureName);
+	return getTexture(getTextureHandle(textureName));
 }
 
 void Assets::addAnimation(const std::string& animationName, const std::string& textureName, size_t frameCount, size_t speed)
 {
 	PROFILE_FUNCTION();
-	m_animationMap[animationName] = Animation(animationName, getTexture(textureName), frameCount, speed);
 
-	std::cout << "Loaded Animation: " << animationName << std::endl;
+	auto it = m_animationNames.find(animationName);
+	size_t index = (it != m_animationNames.end()) ? it->second : m_animations.size();
+	if (index == m_animations.size())
+	{
+		m_animations.emplace_back();
+		m_animationNames[animationName] = index;
+	}
+
+	TextureHandle texture = getTextureHandle(textureName);
+	if (!texture.valid())
+	{
+		std::cerr << "Animation " << animationName << " refers to unknown texture: " << textureName << std::endl;
+		return;
+	}
+
+	// the animation is built once its texture has been uploaded
+	m_pendingAnimations.push_back({ index, animationName, texture.index, frameCount, speed });
+	m_pendingTotal++;
+}
+
+AnimationHandle Assets::getAnimationHandle(const std::string& animationName) const
+{
+	auto it = m_animationNames.find(animationName);
+	assert(it != m_animationNames.end());
+	return it != m_animationNames.end() ? AnimationHandle(it->second) : AnimationHandle();
 }
 
 const Animation& Assets::getAnimation(const std::string& animationName) const
 {
-	assert(m_animationMap.find(animationName) != m_animationMap.end());
-	return m_animationMap.at(animationName);
+	return getAnimation(getAnimationHandle(animationName));
 }
 
 void Assets::addFont(const std::string& fontName, const std::string& path)
 {
 	PROFILE_FUNCTION();
-	m_fontMap[fontName] = sf::Font();
+	auto it = m_fontNames.find(fontName);
+	bool isNew = (it == m_fontNames.end());
+	sf::Font& font = isNew ? m_fonts.emplace_back() : m_fonts[it->second];
 
-	if (!m_fontMap[fontName].loadFromFile(path))
+	if (!font.loadFromFile(path))
 	{
 		std::cerr << "Could not load font file: " << path << std::endl;
-		m_fontMap.erase(fontName);
+		if (isNew) { m_fonts.pop_back(); }
 	}
 	else
 	{
+		if (isNew) { m_fontNames[fontName] = m_fonts.size() - 1; }
 		std::cout << "Loaded Font: " << path << std::endl;
 	}
 }
 
+FontHandle Assets::getFontHandle(const std::string& fontName) const
+{
+	auto it = m_fontNames.find(fontName);
+	assert(it != m_fontNames.end());
+	return it != m_fontNames.end() ? FontHandle(it->second) : FontHandle();
+}
+
 const sf::Font& Assets::getFont(const std::string& fontName) const
 {
-	assert(m_fontMap.find(fontName) != m_fontMap.end());
-	return m_fontMap.at(fontName);
-}
\ No newline at end of file
+	return getFont(getFontHandle(fontName));
+}
@@ -2,24 +2,104 @@
 
 #include "Common.h"
 #include "Animation.h"
+#include "AssetHandle.h"
+#include "MappedFile.h"
+
+#include <deque>
+#include <unordered_map>
+#include <future>
+
+typedef std::unordered_map<std::string, size_t> AssetNameTable;
 
 class Assets
 {
-	std::map<std::string, sf::Texture>	m_textureMap;
-	std::map<std::string, Animation>	m_animationMap;
-	std::map<std::string, sf::Font>		m_fontMap;
+	// a texture whose image is being decoded on the thread pool
+	struct PendingTexture
+	{
+		size_t					index;
+		std::string				path;
+		bool					smooth;
+		std::future<sf::Image>	image;
+	};
+
+	// an animation waiting on its texture to be uploaded
+	struct PendingAnimation
+	{
+		size_t					index;
+		std::string				name;
+		size_t					textureIndex;
+		size_t					frameCount;
+		size_t					speed;
+	};
+
+	// textures and fonts live in deques so that adding new ones never moves
+	// existing ones, sprites and texts hold raw pointers to them
+	std::deque<sf::Texture>		m_textures;
+	std::vector<sf::Vector2u>	m_textureSizes;		// known even when headless, where textures stay empty
+	std::vector<Animation>		m_animations;
+	std::deque<sf::Font>		m_fonts;
+
+	// headless runs (benchmarks, replays, tests) have no GL context, images are decoded but never uploaded
+	bool						m_headless = false;
+
+	// hashed name -> index tables, only used to resolve handles
+	AssetNameTable				m_textureNames;
+	AssetNameTable				m_animationNames;
+	AssetNameTable				m_fontNames;
+
+	// keeps a loaded bundle mapped, bundled fonts are read straight from it
+	MappedFile					m_bundle;
+
+	std::vector<PendingTexture>		m_pendingTextures;
+	std::vector<PendingAnimation>	m_pendingAnimations;
+	size_t							m_pendingTotal = 0;
 
 	void addTexture(const std::string& textureName, const std::string& path, bool smooth = true);
 	void addAnimation(const std::string& animationName, const std::string& textureName, size_t frameCount, size_t speed);
 	void addFont(const std::string& fontName, const std::string& path);
 
+	void uploadTexture(PendingTexture& pending);
+	void resolveAnimations();
+
 public:
 
 	Assets();
+	~Assets();
 
+	// must be set before anything is loaded
+	void setHeadless(bool headless);
+
+	// blocking load, equivalent to loadFromFileAsync() followed by finishLoading()
 	void loadFromFile(const std::string& path);
 
+	// reserves a handle for every asset in the file and decodes the images on the thread pool
+	// fonts are loaded immediately since they are small and the menu needs them on its first frame
+	// textures and animations become usable as update() or finishLoading() uploads them
+	void loadFromFileAsync(const std::string& path);
+
+	// loads a bundle written by AssetBundle::Build, no parsing or image decoding involved
+	bool loadFromBundle(const std::string& path);
+
+	// uploads any images that have finished decoding, call once per frame from the main (GL) thread
+	void update();
+
+	// blocks until every pending asset has been decoded and uploaded
+	void finishLoading();
+
+	bool isLoaded() const;
+	size_t pendingCount() const;
+	size_t pendingTotal() const;
+
+	TextureHandle	getTextureHandle(const std::string& textureName) const;
+	AnimationHandle	getAnimationHandle(const std::string& animationName) const;
+	FontHandle		getFontHandle(const std::string& fontName) const;
+
+	const sf::Texture&	getTexture(TextureHandle handle) const		{ return m_textures[handle.index]; }
+	const Animation&	getAnimation(AnimationHandle handle) const	{ return m_animations[handle.index]; }
+	const sf::Font&		getFont(FontHandle handle) const			{ return m_fonts[handle.index]; }
+
+	// convenience lookups by name, prefer resolving a handle once outside of hot paths
 	const sf::Texture& getTexture(const std::string& textureName) const;
 	const Animation& getAnimation(const std::string& animationName) const;
 	const sf::Font& getFont(const std::string& fontName) const;
-};
\ No newline at end of file
+};
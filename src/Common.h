@@ -4,6 +4,7 @@
 #include <SFML/Audio.hpp>
 
 #include <vector>
+#include <map>
 #include <iostream>
 #include <memory>
 #include <fstream>
@@ -3,6 +3,10 @@
 #include "Animation.h"
 #include "Assets.h"
 
+#include <cstdint>
+
+// components are plain data, the pool copies them as raw memory for snapshots
+// anything that owns memory (strings, sprites) is referred to by a handle instead
 class Component
 {
 public:
@@ -17,12 +21,16 @@ public:
 	Vec2 scale		= { 1.0, 1.0 };
 	Vec2 velocity	= { 0.0, 0.0 };
 	float angle		= 0;
+	uint32_t version = 0;	// changes whenever pos, scale or angle are written through moved()
 
 	CTransform() {}
 	CTransform(const Vec2& p)
 		: pos(p), prevPos(p) {}
 	CTransform(const Vec2& p, const Vec2& sp, const Vec2& sc, float a)
 		: pos(p), prevPos(p), velocity(sp), scale(sc), angle(a) {}
+
+	// call after writing pos, scale or angle, whatever was worked out from them (CSprite) is stale
+	void moved() { version++; }
 };
 
 class CLifespan : public Component
@@ -62,11 +70,33 @@ public:
 class CAnimation : public Component
 {
 public:
-	Animation animation;
-	bool repeat = false;
+	AnimationHandle handle;					// the Animation in Assets that holds the texture
+	Vec2		size			= { 1, 1 };	// size of one frame
+	uint32_t	frameCount		= 1;
+	uint32_t	speed			= 0;		// ticks per frame, 0 never advances
+	uint32_t	currentFrame	= 0;		// ticks played so far
+	bool		repeat			= false;
 	CAnimation() {}
 	CAnimation(const Animation& animation, bool r)
-		: animation(animation), repeat(r) {}
+		: handle(animation.getHandle()), size(animation.getSize())
+		, frameCount((uint32_t)animation.getFrameCount()), speed((uint32_t)animation.getSpeed()), repeat(r) {}
+
+	// advances a tick, the animation loops when it reaches the end
+	void update()
+	{
+		if (speed > 0) { currentFrame++; }
+	}
+
+	bool hasEnded() const
+	{
+		return currentFrame == (frameCount - 1) * speed;
+	}
+
+	// the frame to draw, its texture rect starts at frame() * size.x
+	uint32_t frame() const
+	{
+		return speed > 0 ? (currentFrame / speed) % frameCount : 0;
+	}
 };
 
 class CGravity : public Component
@@ -77,12 +107,14 @@ public:
 	CGravity(float g) : gravity(g) {}
 };
 
+enum class PlayerState : unsigned char { Air, Ground };
+
 class CState : public Component
 {
 public:
-	std::string state = "air";
+	PlayerState state = PlayerState::Air;
 	CState() {}
-	CState(const std::string& s) : state(s) {}
+	CState(PlayerState s) : state(s) {}
 };
 
 class CDraggable : public Component
@@ -90,4 +122,16 @@ class CDraggable : public Component
 public:
 	bool dragging = false;
 	CDraggable() {}
+};
+
+// the quad sRender last built for the entity, reused until the transform or the animation frame changes
+class CSprite : public Component
+{
+public:
+	sf::Vertex		quad[4];
+	AnimationHandle	handle;					// the animation, frame and CTransform::version the quad was built for
+	uint32_t		frame		= 0;
+	uint32_t		version		= 0;
+	bool			built		= false;
+	CSprite() {}
 };
\ No newline at end of file
@@ -8,6 +8,9 @@ EntityManager::EntityManager()
 void EntityManager::update()
 {
 	PROFILE_FUNCTION();
+
+	AllocationTracker::Reserve(m_entities, m_entities.size() + m_entitiesToAdd.size());
+
 	// add all the entities that are pending
 	for (auto e : m_entitiesToAdd)
 	{
@@ -17,12 +20,21 @@ void EntityManager::update()
 		// add it to the entitiy map in the correct place
 		// map[key] will crete an element at 'key' if it does not already exist
 		//			therefore we are not in danger of adding to a vector that doesn't exist
-		m_entityMap[e.tag()].push_back(e);
+		EntityVec& tagged = m_entityMap[e.tag()];
+		AllocationTracker::Reserve(tagged, tagged.size() + 1);
+		tagged.push_back(e);
 	}
 
 	// clear the temporary vector since we have added everything
 	m_entitiesToAdd.clear();
 
+	// every entity is in m_entities exactly once, so this is where dead slots go back to the pool
+	// a slot reused before every vector had dropped it would bring the dead entity back to life
+	for (auto e : m_entities)
+	{
+		if (!e.isActive()) { EntityMemoryPool::Instance().releaseEntity(e.id()); }
+	}
+
 	// clean up dead entities in all vectors
 	removeDeadEntities(m_entities); 
 	m_totalEntities = m_entities.size();
@@ -51,6 +63,38 @@ Entity EntityManager::addEntity(const Tag tag)
 	return e;
 }
 
+void EntityManager::reserve(size_t count)
+{
+	m_entitiesToAdd.reserve(m_entitiesToAdd.size() + count);
+	m_entities.reserve(m_entities.size() + m_entitiesToAdd.size() + count);
+}
+
+void EntityManager::clear()
+{
+	for (auto e : m_entitiesToAdd) { e.destroy(); }
+	for (auto e : m_entities) { e.destroy(); }
+	update();
+}
+
+void EntityManager::restore(const std::vector<size_t>& entities, const std::vector<size_t>& pending)
+{
+	EntityMemoryPool& pool = EntityMemoryPool::Instance();
+
+	m_entities.clear();
+	m_entitiesToAdd.clear();
+	for (auto& [tag, entityVec] : m_entityMap) { entityVec.clear(); }
+
+	for (size_t id : entities)
+	{
+		Entity e = pool.getEntity(id);
+		m_entities.push_back(e);
+		m_entityMap[e.tag()].push_back(e);
+	}
+	for (size_t id : pending) { m_entitiesToAdd.push_back(pool.getEntity(id)); }
+
+	m_totalEntities = m_entities.size();
+}
+
 const EntityVec& EntityManager::getEntities()
 {
 	return m_entities;
@@ -61,6 +105,11 @@ const EntityVec& EntityManager::getEntities(const Tag tag)
 	return m_entityMap[tag];
 }
 
+const EntityVec& EntityManager::getPending() const
+{
+	return m_entitiesToAdd;
+}
+
 const size_t EntityManager::getTotal() const
 {
 	return m_totalEntities;
@@ -23,7 +23,18 @@ public:
 
 	Entity addEntity(const Tag tag);
 
+	// makes room for count more entities so a bulk spawn never reallocates
+	void reserve(size_t count);
+
+	// destroys every entity, including ones not yet added, and hands their slots back to the pool
+	void clear();
+
+	// rebuilds the manager from the ids of a saved entity list and pending list, restore the pool first
+	// the tag lists keep the order the entities have, which is what update() would have left them in
+	void restore(const std::vector<size_t>& entities, const std::vector<size_t>& pending);
+
 	const EntityVec& getEntities();
+	const EntityVec& getPending() const;
 	const EntityVec& getEntities(const Tag tag);
 	const size_t getTotal() const;
 };
\ No newline at end of file
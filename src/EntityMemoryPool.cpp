@@ -1,21 +1,66 @@
 #include "EntityMemoryPool.h"
 #include "Entity.h"
 
-EntityMemoryPool::EntityMemoryPool(size_t maxEntities)
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	template <typename... Ts>
+	size_t SlotBytes(const std::tuple<std::vector<Ts>...>*)
+	{
+		return (sizeof(Ts) + ...);
+	}
+}
+
+void EntityMemoryPool::Configure(const EntityPoolConfig& config)
+{
+	s_config = config;
+}
+
+EntityMemoryPool::EntityMemoryPool(const EntityPoolConfig& config)
 {
 	m_numEntities = 0;
-	m_active = std::vector<bool>(maxEntities, false);
-	m_tags = std::vector<Tag>(maxEntities);
-	m_pool = {
-			std::vector<CTransform>	 (maxEntities),
-			std::vector<CLifespan>	 (maxEntities),
-			std::vector<CInput>		 (maxEntities),
-			std::vector<CBoundingBox>(maxEntities),
-			std::vector<CAnimation>	 (maxEntities),
-			std::vector<CGravity>	 (maxEntities),
-			std::vector<CState>		 (maxEntities),
-			std::vector<CDraggable>	 (maxEntities)
-	};
+
+	// a power of two page size turns every lookup into a shift and a mask
+	m_pageShift = 0;
+	while (((size_t)1 << m_pageShift) < std::max<size_t>(config.pageSize, 1)) { m_pageShift++; }
+	m_pageSize = (size_t)1 << m_pageShift;
+	m_maxEntities = config.maxEntities;
+
+	for (size_t i = 0; i < std::max<size_t>(config.initialPages, 1); i++) { addPage(); }
+}
+
+void EntityMemoryPool::addPage()
+{
+	PROFILE_FUNCTION();
+
+	// every vector sized by the entities may have to follow, see AllocationTracker::Growing
+	AllocationTracker::Growing();
+
+	// the vectors are sized once and never touched again, which is what keeps references stable
+	m_pages.push_back(std::make_unique<EntityComponentVectorTuple>(
+		std::vector<CTransform>	 (m_pageSize),
+		std::vector<CLifespan>	 (m_pageSize),
+		std::vector<CInput>		 (m_pageSize),
+		std::vector<CBoundingBox>(m_pageSize),
+		std::vector<CAnimation>	 (m_pageSize),
+		std::vector<CGravity>	 (m_pageSize),
+		std::vector<CState>		 (m_pageSize),
+		std::vector<CDraggable>	 (m_pageSize),
+		std::vector<CSprite>	 (m_pageSize)
+	));
+	m_pageAllocated.push_back(0);
+
+	std::apply([this](auto&... components)
+	{
+		(std::get<std::vector<typename std::decay_t<decltype(components)>::pointer>>(m_pageTable).push_back(components.data()), ...);
+	}, *m_pages.back());
+
+	m_active.resize(capacity(), false);
+	m_allocated.resize(capacity(), false);
+	m_tags.resize(capacity());
 }
 
 const Tag EntityMemoryPool::getTag(size_t entityID) const
@@ -28,17 +73,30 @@ const bool EntityMemoryPool::isActive(size_t entityID) const
 	return m_active[entityID];
 }
 
+Entity EntityMemoryPool::getEntity(size_t entityID) const
+{
+	return Entity(entityID);
+}
+
 size_t EntityMemoryPool::getNextEntityIndex()
 {
-	// get first index in the active vector where the active flag is false
+	// get first slot that is not allocated, destroyed entities keep their slot until released
+	// searching from the lowest slot that can be free keeps bulk spawns linear
 	auto iterator = std::find_if(
-		m_active.begin(),
-		m_active.end(),
+		m_allocated.begin() + m_firstFree,
+		m_allocated.end(),
 		[](bool e) { return !e; });
 
-	return iterator != m_active.end() 
-		? iterator - m_active.begin() 
-		: -1;
+	size_t index = iterator - m_allocated.begin();
+	if (m_maxEntities > 0 && index >= m_maxEntities)
+	{
+		std::cerr << "EntityMemoryPool: all " << m_maxEntities << " entities are in use, raise --pool-capacity" << std::endl;
+		std::abort();
+	}
+
+	// every slot is taken, the first slot of a new page is free
+	if (index == capacity()) { addPage(); }
+	return index;
 }
 
 Entity EntityMemoryPool::addEntity(const Tag tag)
@@ -47,16 +105,24 @@ Entity EntityMemoryPool::addEntity(const Tag tag)
 
 	m_tags[index] = tag;
 	m_active[index] = true;
+	m_allocated[index] = true;
+	m_numAllocated++;
+	m_peakAllocated = std::max(m_peakAllocated, m_numAllocated);
+	m_pageAllocated[index >> m_pageShift]++;
+	m_firstFree = index + 1;
+	m_highWater = std::max(m_highWater, index + 1);
 
 	// set components to default
-	std::get<std::vector<CTransform>>  (m_pool)[index]	= CTransform();
-	std::get<std::vector<CLifespan>>   (m_pool)[index]	= CLifespan();
-	std::get<std::vector<CInput>>	   (m_pool)[index]	= CInput();
-	std::get<std::vector<CBoundingBox>>(m_pool)[index]	= CBoundingBox();
-	std::get<std::vector<CAnimation>>  (m_pool)[index]	= CAnimation();
-	std::get<std::vector<CGravity>>	   (m_pool)[index]	= CGravity();
-	std::get<std::vector<CState>>	   (m_pool)[index]	= CState();
-	std::get<std::vector<CDraggable>>  (m_pool)[index]	= CDraggable();
+	size_t i = slot(index);
+	slots<CTransform>  (index)[i]	= CTransform();
+	slots<CLifespan>   (index)[i]	= CLifespan();
+	slots<CInput>	   (index)[i]	= CInput();
+	slots<CBoundingBox>(index)[i]	= CBoundingBox();
+	slots<CAnimation>  (index)[i]	= CAnimation();
+	slots<CGravity>	   (index)[i]	= CGravity();
+	slots<CState>	   (index)[i]	= CState();
+	slots<CDraggable>  (index)[i]	= CDraggable();
+	slots<CSprite>	   (index)[i]	= CSprite();
 
 	m_numEntities++;
 	return Entity(index);
@@ -64,6 +130,139 @@ Entity EntityMemoryPool::addEntity(const Tag tag)
 
 void EntityMemoryPool::destroyEntity(size_t entityID)
 {
+	// an entity can be destroyed twice in one frame, a brick blown up as its chunk unloads, only the first destroy counts
+	if (!m_active[entityID]) { return; }
+
 	m_numEntities--;
 	m_active[entityID] = false;
-}
\ No newline at end of file
+}
+
+void EntityMemoryPool::releaseEntity(size_t entityID)
+{
+	m_allocated[entityID] = false;
+	m_numAllocated--;
+	m_pageAllocated[entityID >> m_pageShift]--;
+	m_firstFree = std::min(m_firstFree, entityID);
+
+	// snapshots stop at the last slot in use
+	if (entityID + 1 == m_highWater)
+	{
+		while (m_highWater > 0 && !m_allocated[m_highWater - 1]) { m_highWater--; }
+	}
+}
+
+size_t EntityPoolSnapshot::bytes() const
+{
+	size_t total = tags.size() * sizeof(Tag) + active.size() + allocated.size() + pageAllocated.size() * sizeof(size_t);
+	for (auto& component : components) { total += component.size(); }
+	return total;
+}
+
+void EntityMemoryPool::snapshot(EntityPoolSnapshot& snapshot)
+{
+	PROFILE_FUNCTION();
+
+	// sized up front, a snapshot taken over and over is never cleared or reallocated until the high water
+	// outgrows the room it was given
+	for (size_t c = 0; c < EntityPoolSnapshot::ComponentCount; c++)
+	{
+		AllocationTracker::Reserve(snapshot.components[c], EntityPoolSnapshot::ComponentSizes[c] * m_highWater);
+		snapshot.components[c].resize(EntityPoolSnapshot::ComponentSizes[c] * m_highWater);
+	}
+	forEachComponentRange(m_highWater, [&snapshot](size_t component, size_t offset, const void* data, size_t bytes)
+	{
+		std::memcpy(snapshot.components[component].data() + offset, data, bytes);
+	});
+
+	AllocationTracker::Reserve(snapshot.tags, m_highWater);
+	AllocationTracker::Reserve(snapshot.active, m_highWater);
+	AllocationTracker::Reserve(snapshot.allocated, m_highWater);
+	snapshot.tags.assign(m_tags.begin(), m_tags.begin() + m_highWater);
+	snapshot.active.assign(m_active.begin(), m_active.begin() + m_highWater);
+	snapshot.allocated.assign(m_allocated.begin(), m_allocated.begin() + m_highWater);
+	snapshot.pageAllocated = m_pageAllocated;
+	snapshot.numEntities	= m_numEntities;
+	snapshot.numAllocated	= m_numAllocated;
+	snapshot.firstFree		= m_firstFree;
+	snapshot.highWater		= m_highWater;
+}
+
+void EntityMemoryPool::restore(const EntityPoolSnapshot& snapshot)
+{
+	PROFILE_FUNCTION();
+
+	// pages are never freed so they are all still here, entities come back at the same ids
+	while (m_pages.size() < snapshot.pageAllocated.size()) { addPage(); }
+
+	forEachComponentRange(snapshot.highWater, [&snapshot](size_t component, size_t offset, void* data, size_t bytes)
+	{
+		std::memcpy(data, snapshot.components[component].data() + offset, bytes);
+	});
+
+	std::copy(snapshot.tags.begin(), snapshot.tags.end(), m_tags.begin());
+	std::copy(snapshot.active.begin(), snapshot.active.end(), m_active.begin());
+	std::copy(snapshot.allocated.begin(), snapshot.allocated.end(), m_allocated.begin());
+
+	// slots first used after the snapshot are free again, their components are reset when reused
+	std::fill(m_active.begin() + snapshot.highWater, m_active.begin() + std::max(m_highWater, snapshot.highWater), false);
+	std::fill(m_allocated.begin() + snapshot.highWater, m_allocated.begin() + std::max(m_highWater, snapshot.highWater), false);
+
+	std::fill(m_pageAllocated.begin(), m_pageAllocated.end(), 0);
+	std::copy(snapshot.pageAllocated.begin(), snapshot.pageAllocated.end(), m_pageAllocated.begin());
+	m_numEntities	= snapshot.numEntities;
+	m_numAllocated	= snapshot.numAllocated;
+	m_firstFree		= snapshot.firstFree;
+	m_highWater		= snapshot.highWater;
+}
+
+size_t EntityMemoryPool::activeCount() const
+{
+	return (size_t)m_numEntities;
+}
+
+size_t EntityMemoryPool::allocatedCount() const
+{
+	return m_numAllocated;
+}
+size_t EntityMemoryPool::peakAllocated() const
+{
+	return m_peakAllocated;
+}
+
+size_t EntityMemoryPool::capacity() const
+{
+	return m_pages.size() * m_pageSize;
+}
+
+size_t EntityMemoryPool::pageCount() const
+{
+	return m_pages.size();
+}
+
+size_t EntityMemoryPool::pageSize() const
+{
+	return m_pageSize;
+}
+
+void EntityMemoryPool::report(std::ostream& out) const
+{
+	// the components plus the tag and the two flags
+	size_t slotBytes = SlotBytes((const EntityComponentVectorTuple*)nullptr) + sizeof(Tag);
+	double pageMB = slotBytes * m_pageSize / (1024.0 * 1024.0);
+
+	char line[160];
+	std::snprintf(line, sizeof(line), "Entity pool: %zu pages of %zu slots (%zu bytes a slot, %.2f MB a page, %.2f MB in all)\n",
+		m_pages.size(), m_pageSize, slotBytes, pageMB, pageMB * m_pages.size());
+	out << line;
+	std::snprintf(line, sizeof(line), "  allocated %zu of %zu (%.1f%%), peak %zu, limit %s\n",
+		m_numAllocated, capacity(), 100.0 * m_numAllocated / capacity(), m_peakAllocated,
+		m_maxEntities > 0 ? std::to_string(m_maxEntities).c_str() : "none");
+	out << line;
+
+	for (size_t page = 0; page < m_pages.size(); page++)
+	{
+		std::snprintf(line, sizeof(line), "  page %3zu  %6zu / %zu  %5.1f%%\n",
+			page, m_pageAllocated[page], m_pageSize, 100.0 * m_pageAllocated[page] / m_pageSize);
+		out << line;
+	}
+}
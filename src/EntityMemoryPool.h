@@ -3,6 +3,10 @@
 #include "Common.h"
 #include "Components.h"
 
+#include <type_traits>
+
+// bullets are no longer entities (see ProjectilePool), the tag keeps its place so the values
+// hashed into the checksums of existing recordings stay the same
 enum class Tag { player, bullet, tile, decoration, };
 
 class Entity;
@@ -15,25 +19,121 @@ typedef std::tuple<
 	std::vector<CAnimation>,
 	std::vector<CGravity>,
 	std::vector<CState>,
-	std::vector<CDraggable>
+	std::vector<CDraggable>,
+	std::vector<CSprite>
 > EntityComponentVectorTuple;
 
-const long long MAX_ENTITIES = 100000;
+// snapshots copy the component pages as raw memory
+template <typename Tuple> struct TriviallyCopyableComponents;
+template <typename... Ts> struct TriviallyCopyableComponents<std::tuple<std::vector<Ts>...>>
+{
+	static const bool value = (std::is_trivially_copyable_v<Ts> && ...);
+};
+static_assert(TriviallyCopyableComponents<EntityComponentVectorTuple>::value, "every component must be trivially copyable");
+
+template <typename Tuple> struct ComponentSizesOf;
+template <typename... Ts> struct ComponentSizesOf<std::tuple<std::vector<Ts>...>>
+{
+	static constexpr size_t value[] = { sizeof(Ts)... };
+};
+
+// the pool grows a page at a time, every page holds pageSize slots of every component
+// pages are never moved or freed, so entity ids and component references stay valid as it grows
+struct EntityPoolConfig
+{
+	size_t pageSize		= 4096;		// rounded up to a power of two
+	size_t initialPages	= 1;
+	size_t maxEntities	= 0;		// 0 grows without limit
+};
+
+// the same components as pointers to the start of each page, one lookup away from any slot
+template <typename Tuple> struct EntityPageTableOf;
+template <typename... Ts> struct EntityPageTableOf<std::tuple<std::vector<Ts>...>>
+{
+	typedef std::tuple<std::vector<Ts*>...> type;
+};
+typedef EntityPageTableOf<EntityComponentVectorTuple>::type EntityPageTable;
+
+// the whole pool as it was when taken, every component of every slot up to the highest one in use
+// copied with one memcpy per component per page, keep one around and reuse it so saving never allocates
+// each component type gets its own array with the slots in id order, so a slot's bytes sit at the
+// same offset in every snapshot however far the pool has grown
+struct EntityPoolSnapshot
+{
+	static const size_t ComponentCount = std::tuple_size_v<EntityComponentVectorTuple>;
+	static constexpr const size_t* ComponentSizes = ComponentSizesOf<EntityComponentVectorTuple>::value;
+
+	std::vector<unsigned char>	components[ComponentCount];
+	std::vector<Tag>			tags;
+	std::vector<unsigned char>	active;
+	std::vector<unsigned char>	allocated;
+	std::vector<size_t>			pageAllocated;
+	long long					numEntities		= 0;
+	size_t						numAllocated	= 0;
+	size_t						firstFree		= 0;
+	size_t						highWater		= 0;
+
+	size_t bytes() const;
+};
 
 class EntityMemoryPool
 {
+	static inline EntityPoolConfig	s_config;
+
+	typedef std::unique_ptr<EntityComponentVectorTuple> Page;
+
 	long long					m_numEntities;
-	EntityComponentVectorTuple	m_pool;
+	size_t						m_numAllocated = 0;	// live entities plus destroyed ones not yet released
+	size_t						m_peakAllocated = 0;
+	size_t						m_firstFree = 0;	// no free slot exists below this index
+	size_t						m_highWater = 0;	// every slot at or above this index is free
+	size_t						m_pageSize;
+	size_t						m_pageShift;
+	size_t						m_maxEntities;
+	std::vector<Page>			m_pages;
+	EntityPageTable				m_pageTable;
+	std::vector<size_t>			m_pageAllocated;	// occupancy of each page
 	std::vector<Tag>	m_tags;
 	std::vector<bool>			m_active;
-	EntityMemoryPool(size_t maxEntities);
+	std::vector<bool>			m_allocated;	// slot is in use, stays set from addEntity until releaseEntity
+	EntityMemoryPool(const EntityPoolConfig& config);
+
+	void addPage();
 
-	// TODO: keep a reference to the last accessed index
+	template <typename T>
+	T* slots(size_t entityID)
+	{
+		return std::get<std::vector<T*>>(m_pageTable)[entityID >> m_pageShift];
+	}
+
+	size_t slot(size_t entityID) const
+	{
+		return entityID & (m_pageSize - 1);
+	}
+
+	// calls f(component, offset, data, bytes) for every component of every page, over the slots below count
+	// offset is where the page starts in an array holding every slot of that component
+	template <typename F>
+	void forEachComponentRange(size_t count, F f)
+	{
+		for (size_t page = 0; page * m_pageSize < count; page++)
+		{
+			size_t slots = std::min(m_pageSize, count - page * m_pageSize);
+			size_t component = 0;
+			std::apply([&](auto&... tables)
+			{
+				(f(component++, page * m_pageSize * sizeof(*tables[page]), tables[page], slots * sizeof(*tables[page])), ...);
+			}, m_pageTable);
+		}
+	}
 
 public:
+	// must be called before the pool is first used, later calls have no effect
+	static void Configure(const EntityPoolConfig& config);
+
 	static EntityMemoryPool& Instance()
 	{
-		static EntityMemoryPool pool(MAX_ENTITIES);
+		static EntityMemoryPool pool(s_config);
 		return pool;
 	}
 
@@ -41,22 +141,46 @@ public:
 
 	const bool isActive(size_t entityID) const;
 
+	size_t activeCount() const;
+	size_t allocatedCount() const;
+	size_t peakAllocated() const;
+	size_t capacity() const;
+	size_t pageCount() const;
+	size_t pageSize() const;
+
+	// occupancy of every page and the memory behind them, for sizing pageSize and maxEntities
+	void report(std::ostream& out) const;
+
+	// copies every entity and component into snapshot, reusing its buffers
+	// the pool is shared, so this covers every scene's entities
+	void snapshot(EntityPoolSnapshot& snapshot);
+
+	// puts the pool back exactly as it was when snapshot was taken, entities made since then are gone
+	// the EntityManagers that hold the entities have to be put back alongside it
+	void restore(const EntityPoolSnapshot& snapshot);
+
+	// the entity behind an id the pool handed out earlier, for rebuilding saved entity lists
+	Entity getEntity(size_t entityID) const;
+
 	size_t getNextEntityIndex();
 
 	Entity addEntity(const Tag tag);
 
 	void destroyEntity(size_t entityID);
 
+	// returns a destroyed entity's slot to the pool, called by the EntityManager once it holds no more references to it
+	void releaseEntity(size_t entityID);
+
 	template <typename T>
 	bool hasComponent(size_t entityID)
 	{
-		return std::get<std::vector<T>>(m_pool)[entityID].has;
+		return slots<T>(entityID)[slot(entityID)].has;
 	}
 
 	template <typename T, typename... TArgs>
 	T& addComponent(size_t entityID, TArgs&&... mArgs)
 	{
-		auto& component = std::get<std::vector<T>>(m_pool)[entityID];
+		auto& component = slots<T>(entityID)[slot(entityID)];
 		component = T(std::forward<TArgs>(mArgs)...);
 		component.has = true;
 		return component;
@@ -65,7 +189,7 @@ public:
 	template <typename T>
 	T& removeComponent(size_t entityID)
 	{
-		auto& component = std::get<std::vector<T>>(m_pool)[entityID];
+		auto& component = slots<T>(entityID)[slot(entityID)];
 		component.has = false;
 		return component;
 	}
@@ -73,6 +197,6 @@ public:
 	template <typename T>
 	T& getComponent(size_t entityID)
 	{
-		return std::get<std::vector<T>>(m_pool)[entityID];
+		return slots<T>(entityID)[slot(entityID)];
 	}
 };
\ No newline at end of file
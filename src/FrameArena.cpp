@@ -0,0 +1,70 @@
+#include "FrameArena.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+FrameArena::FrameArena(size_t capacity)
+	: m_block(new std::byte[capacity])
+	, m_capacity(capacity)
+	, m_spill(std::pmr::new_delete_resource())
+{
+
+}
+
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+	size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+	if (start + bytes <= m_capacity)
+	{
+		m_used = start + bytes;
+		return m_block.get() + start;
+	}
+
+	// out of room this frame, the heap covers it and the block is grown at the next reset
+	m_overflow += bytes + alignment;
+	return m_spill.allocate(bytes, alignment);
+}
+
+void FrameArena::do_deallocate(void*, size_t, size_t)
+{
+	// everything is released at once by reset
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+void FrameArena::reset()
+{
+	m_peak = std::max(m_peak, m_used + m_overflow);
+
+	if (m_overflow > 0)
+	{
+		PROFILE_FUNCTION();
+
+		// grow by at least half again so a slowly growing workload does not reallocate every frame
+		size_t capacity = std::max(m_capacity + m_capacity / 2, m_used + m_overflow);
+		m_block.reset(new std::byte[capacity]);
+		m_capacity = capacity;
+		m_spill.release();
+		m_overflow = 0;
+	}
+
+	m_used = 0;
+}
+
+size_t FrameArena::used() const
+{
+	return m_used + m_overflow;
+}
+
+size_t FrameArena::capacity() const
+{
+	return m_capacity;
+}
+
+size_t FrameArena::peak() const
+{
+	return m_peak;
+}
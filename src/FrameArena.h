@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory_resource>
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// linear allocator for data that only lives for one frame, owned by the GameEngine and reset
+// at the top of every update. Allocating bumps a pointer and freeing does nothing, so anything
+// built on it must be dropped before the next update. Main thread only
+//
+// it is a std::pmr::memory_resource, transient containers use the Frame* aliases below:
+//   FrameVector<Entity> visible(&m_game->frameArena());
+//
+// a frame that runs past the block spills into the heap, the next reset grows the block to fit
+// so a steady workload stops touching the heap after its first frame
+class FrameArena : public std::pmr::memory_resource
+{
+	std::unique_ptr<std::byte[]>		m_block;
+	size_t								m_capacity	= 0;
+	size_t								m_used		= 0;
+	size_t								m_overflow	= 0;	// bytes this frame that did not fit
+	size_t								m_peak		= 0;	// most bytes used by any frame
+	std::pmr::monotonic_buffer_resource	m_spill;			// holds the overflow until the next reset
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+public:
+
+	static const size_t DefaultCapacity = 256 * 1024;
+
+	FrameArena(size_t capacity = DefaultCapacity);
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// releases everything allocated since the last reset
+	void reset();
+
+	size_t used() const;
+	size_t capacity() const;
+	size_t peak() const;
+};
+
+template <typename T>
+using FrameVector = std::pmr::vector<T>;
+using FrameString = std::pmr::string;
@@ -2,34 +2,60 @@
 #include "Assets.h"
 #include "Scene_Play.h"
 #include "Scene_Menu.h"
+#include "ThreadPool.h"
 
-GameEngine::GameEngine(const std::string& path)
+GameEngine::GameEngine(const std::string& path, bool headless)
+	: m_headless(headless)
 {
 	init(path);
 }
 
+GameEngine::~GameEngine()
+{
+	// preloads hold a pointer back to the engine, let any still building finish first
+	for (auto& preload : m_preloadedScenes)
+	{
+		preload.second.wait();
+	}
+}
+
 void GameEngine::init(const std::string& path)
 {
 	PROFILE_FUNCTION();
-	m_assets.loadFromFile(path);
 
+	// a pre-baked bundle is mapped and uploaded directly, a text manifest
+	// has its images decoded on the thread pool while the window opens and the menu runs
+	m_assets.setHeadless(m_headless);
+	bool isBundle = path.size() > 7 && path.compare(path.size() - 7, 7, ".bundle") == 0;
+	if (!isBundle || !m_assets.loadFromBundle(path))
+	{
+		// fall back to the text manifest if the bundle is missing, damaged or from another format version
+		m_assets.loadFromFileAsync(isBundle ? "assets.txt" : path);
+	}
+
+	if (!m_headless)
 	{
 		PROFILE_SCOPE("SFML Create Window");
-		m_window.create(sf::VideoMode(1280, 768), "Definitely Not Mario");
+		m_window.create(sf::VideoMode(m_windowSize.x, m_windowSize.y), "Definitely Not Mario");
 		m_window.setFramerateLimit(60);
 	}
+	else
+	{
+		// nothing sets up the views of a window that is never created, and scenes derive their camera from them
+		m_window.setView(defaultView());
+	}
 
 	changeScene("MENU", std::make_shared<Scene_Menu>(this));
 }
 
-std::shared_ptr<Scene> GameEngine::currentScene()
+Scene* GameEngine::currentScene()
 {
-	return m_sceneMap[m_currentScene];
+	return m_activeScene;
 }
 
 bool GameEngine::isRunning()
 {
-	return m_running && m_window.isOpen();
+	return m_running && (m_headless || m_window.isOpen());
 }
 
 sf::RenderWindow& GameEngine::window()
@@ -37,119 +63,245 @@ sf::RenderWindow& GameEngine::window()
 	return m_window;
 }
 
+const sf::Vector2u& GameEngine::windowSize() const
+{
+	return m_windowSize;
+}
+
+sf::View GameEngine::defaultView() const
+{
+	return sf::View(sf::FloatRect(0, 0, (float)m_windowSize.x, (float)m_windowSize.y));
+}
+
+bool GameEngine::headless() const
+{
+	return m_headless;
+}
+
+void GameEngine::clear(const sf::Color& color)
+{
+	if (m_headless) { return; }
+	m_window.clear(color);
+}
+
+void GameEngine::draw(const sf::Drawable& drawable, const sf::RenderStates& states)
+{
+	m_drawCalls++;
+	if (m_headless) { return; }
+	m_window.draw(drawable, states);
+}
+
+void GameEngine::draw(const sf::Vertex* vertices, size_t count, sf::PrimitiveType type, const sf::RenderStates& states)
+{
+	m_drawCalls++;
+	if (m_headless) { return; }
+	m_window.draw(vertices, count, type, states);
+}
+
+FrameArena& GameEngine::frameArena()
+{
+	return m_frameArena;
+}
+
+size_t GameEngine::drawCalls() const
+{
+	// the last complete frame, the current one is still being drawn
+	return m_lastDrawCalls;
+}
+
 void GameEngine::run()
 {
 	while (isRunning())
 	{
+		Profiler::Instance().beginFrame();
 		update();
 	}
+
+	m_replay.finish(m_tick, m_activeScene ? m_activeScene->checksum() : 0);
+}
+
+bool GameEngine::record(const std::string& path)
+{
+	return m_replay.record(path);
+}
+
+bool GameEngine::replay(const std::string& path)
+{
+	if (!m_replay.play(path)) { return false; }
+
+	// a replay is a load test, run it as fast as it will go
+	if (!m_headless) { m_window.setFramerateLimit(0); }
+	return true;
+}
+
+size_t GameEngine::tick() const
+{
+	return m_tick;
+}
+
+void GameEngine::dispatch(const Action& action)
+{
+	m_replay.action(m_tick, action);
+	currentScene()->doAction(action);
+}
+
+const InputEventLog& GameEngine::inputLog() const
+{
+	return m_inputLog;
 }
 
 void GameEngine::sUserInput()
 {
 	PROFILE_FUNCTION();
-	sf::Event event;
-	while (m_window.pollEvent(event))
-	{
-		PROFILE_SCOPE("Poll Event Loop");
 
-		if (event.type == sf::Event::Closed)
-		{
-			PROFILE_SCOPE("Close Event");
-			quit();
-		}
+	m_input.begin(m_tick);
 
-		if (event.type == sf::Event::KeyPressed)
+	// a replay owns the input, the window can still be closed
+	if (m_replay.playing())
+	{
+		sf::Event event;
+		while (!m_headless && m_window.pollEvent(event))
 		{
-			PROFILE_SCOPE("Screenshot Event");
-
-			if (event.key.code == sf::Keyboard::X)
-			{
-				sf::Texture texture;
-				texture.create(m_window.getSize().x, m_window.getSize().y);
-				texture.update(m_window);
-				if (texture.copyToImage().saveToFile("test.png"))
-				{
-					std::cout << "screenshot saved to " << "test.png" << std::endl;
-				}
-			}
+			if (event.type == sf::Event::Closed) { quit(); }
 		}
 
-		if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased)
-		{
-			PROFILE_SCOPE("Key Event");
-
-			// if the current scene does not have an action associated with this key, skip the event
-			if (currentScene()->getActionMap().find(event.key.code) == currentScene()->getActionMap().end()) { continue; }
+		m_replay.feed(m_tick, [this](const Action& action) { currentScene()->doAction(action); });
+		return;
+	}
 
-			// determine start or end action by whether it was key press or release
-			const std::string actionType = (event.type == sf::Event::KeyPressed) ? "START" : "END";
+	if (m_headless) { return; }
 
-			// look up the action and send the action to the scene
-			currentScene()->doAction(Action(currentScene()->getActionMap().at(event.key.code), actionType));
-		}
+	// only fold the events into this tick's input state here, the scene turns it into actions
+	// once, right before it simulates, see Scene::sInput
+	sf::Event event;
+	while (m_window.pollEvent(event))
+	{
+		long long now = Profiler::Now();
 
-		// mouse actions
-		if (event.type == sf::Event::MouseButtonPressed)
+		switch (event.type)
 		{
-			PROFILE_SCOPE("Mouse Pressed Event");
-
-			auto mpos = sf::Mouse::getPosition(m_window);
-			Vec2 pos(mpos.x, mpos.y);
-			switch (event.mouseButton.button)
+			case sf::Event::Closed:
 			{
-				case sf::Mouse::Left:   { currentScene()->doAction(Action("LEFT_CLICK",   "START", pos)); break; }
-				case sf::Mouse::Middle: { currentScene()->doAction(Action("MIDDLE_CLICK", "START", pos)); break; }
-				case sf::Mouse::Right:  { currentScene()->doAction(Action("RIGHT_CLICK",  "START", pos)); break; }
-				default: break;
+				quit();
+				break;
 			}
-		}
+			case sf::Event::KeyPressed:
+			{
+				if (event.key.code == sf::Keyboard::X)
+				{
+					sf::Texture texture;
+					texture.create(m_window.getSize().x, m_window.getSize().y);
+					texture.update(m_window);
+					if (texture.copyToImage().saveToFile("test.png"))
+					{
+						std::cout << "screenshot saved to " << "test.png" << std::endl;
+					}
+				}
 
-		if (event.type == sf::Event::MouseButtonReleased)
-		{
-			PROFILE_SCOPE("Mouse Released Event");
+				if (event.key.code == sf::Keyboard::F9)
+				{
+					// record the next few seconds into results.trace
+					Profiler::Instance().captureFrames(Profiler::HotkeyFrames);
+				}
 
-			auto mpos = sf::Mouse::getPosition(m_window);
-			Vec2 pos(mpos.x, mpos.y);
-			switch (event.mouseButton.button)
+				// held keys repeat, only the first press is an edge worth timing
+				if (event.key.code >= 0 && event.key.code < sf::Keyboard::KeyCount && !m_input.down[event.key.code])
+				{
+					m_inputLog.record(event.type, event.key.code, m_tick, now);
+				}
+				m_input.keyPressed(event.key.code, now);
+				break;
+			}
+			case sf::Event::KeyReleased:
 			{
-				case sf::Mouse::Left:   { currentScene()->doAction(Action("LEFT_CLICK",   "END", pos)); break; }
-				case sf::Mouse::Middle: { currentScene()->doAction(Action("MIDDLE_CLICK", "END", pos)); break; }
-				case sf::Mouse::Right:  { currentScene()->doAction(Action("RIGHT_CLICK",  "END", pos)); break; }
-				default: break;
+				m_inputLog.record(event.type, event.key.code, m_tick, now);
+				m_input.keyReleased(event.key.code, now);
+				break;
 			}
-		}
-
-		if (event.type == sf::Event::MouseMoved)
-		{
-			PROFILE_SCOPE("Mouse Move Event");
-
-			currentScene()->doAction(Action("MOUSE_MOVE", Vec2(event.mouseMove.x, event.mouseMove.y)));
+			case sf::Event::MouseButtonPressed:
+			{
+				m_inputLog.record(event.type, event.mouseButton.button, m_tick, now);
+				m_input.buttonPressed(event.mouseButton.button, Vec2(event.mouseButton.x, event.mouseButton.y), now);
+				break;
+			}
+			case sf::Event::MouseButtonReleased:
+			{
+				m_inputLog.record(event.type, event.mouseButton.button, m_tick, now);
+				m_input.buttonReleased(event.mouseButton.button, Vec2(event.mouseButton.x, event.mouseButton.y), now);
+				break;
+			}
+			case sf::Event::MouseMoved:
+			{
+				if (!m_input.mouseMoved) { m_inputLog.record(event.type, -1, m_tick, now); }
+				m_input.mouseMovedTo(Vec2(event.mouseMove.x, event.mouseMove.y), now);
+				break;
+			}
+			default: break;
 		}
 	}
 }
 
 void GameEngine::changeScene(const std::string& sceneName, std::shared_ptr<Scene> scene, bool endCurrentScene)
 {
-	if (scene)
+	m_sceneChange.name = sceneName;
+	m_sceneChange.scene = scene;
+	m_sceneChange.endCurrent = endCurrentScene;
+	m_sceneChange.pending = true;
+
+	// the very first scene has nothing to wait for
+	if (!m_activeScene) { applySceneChange(); }
+}
+
+void GameEngine::applySceneChange()
+{
+	if (!m_sceneChange.pending) { return; }
+
+	PROFILE_FUNCTION();
+	SceneChange change = std::move(m_sceneChange);
+	m_sceneChange = SceneChange();
+
+	if (change.scene)
 	{
-		m_sceneMap[sceneName] = scene;
+		m_sceneMap[change.name] = change.scene;
 	}
 	else
 	{
-		if (m_sceneMap.find(sceneName) == m_sceneMap.end())
+		if (m_sceneMap.find(change.name) == m_sceneMap.end())
 		{
-			std::cerr << "Warning: Scene does not exist: " << sceneName << std::endl;
+			std::cerr << "Warning: Scene does not exist: " << change.name << std::endl;
 			return;
 		}
 	}
 	
-	if (endCurrentScene)
+	if (change.endCurrent && change.name != m_currentScene)
 	{
-		m_sceneMap.erase(m_sceneMap.find(m_currentScene));
+		m_sceneMap.erase(m_currentScene);
 	}
 
-	m_currentScene = sceneName;
+	m_currentScene = change.name;
+	m_activeScene = m_sceneMap[m_currentScene].get();
+	m_activeScene->onEnter();
+}
+
+void GameEngine::preloadScene(const std::string& key, SceneFactory factory)
+{
+	// each key is only built once, until it is taken
+	if (m_preloadedScenes.find(key) != m_preloadedScenes.end()) { return; }
+
+	PROFILE_FUNCTION();
+	m_preloadedScenes[key] = ThreadPool::Instance().submit(factory).share();
+}
+
+std::shared_ptr<Scene> GameEngine::takePreloadedScene(const std::string& key)
+{
+	auto it = m_preloadedScenes.find(key);
+	if (it == m_preloadedScenes.end()) { return nullptr; }
+
+	PROFILE_FUNCTION();
+	// usually long done by now, otherwise this only waits out the rest of the build
+	std::shared_ptr<Scene> scene = it->second.get();
+	m_preloadedScenes.erase(it);
+	return scene;
 }
 
 void GameEngine::update()
@@ -158,14 +310,50 @@ void GameEngine::update()
 	if (!isRunning())       { return; }
 	if (m_sceneMap.empty()) { return; }
 
+	long long start = Profiler::Now();
+
+	// nothing from the last frame may still point into the arena
+	m_frameArena.reset();
+	applySceneChange();
+	m_assets.update();
+	m_lastDrawCalls = m_drawCalls;
+	m_drawCalls = 0;
+
 	sUserInput();
-	currentScene()->simulate(m_simulationSpeed);
-	currentScene()->sRender();
+	{
+		PROFILE_SCOPE("Simulate");
+		m_activeScene->sInput(m_input);
+		m_activeScene->simulate(m_simulationSpeed);
+	}
+
+	// from polling an event to the end of the tick that acted on it
+	long long inputLatency = m_inputLog.consume(Profiler::Now());
+	if (inputLatency > 0) { PROFILE_COUNTER("Input Latency us", inputLatency / 1000); }
 
+	{
+		PROFILE_SCOPE("Render");
+		m_activeScene->sRender();
+	}
+
+	if (!m_headless)
 	{
 		PROFILE_SCOPE("SFML Display");
 		m_window.display();
 	}
+
+	PROFILE_COUNTER("Draw Calls", m_drawCalls);
+	PROFILE_COUNTER("Pool Allocated", EntityMemoryPool::Instance().allocatedCount());
+	PROFILE_COUNTER("Pool Capacity", EntityMemoryPool::Instance().capacity());
+	PROFILE_COUNTER("Frame Arena Bytes", m_frameArena.used());
+
+	if (m_replay.recording() || m_replay.playing())
+	{
+		long long duration = Profiler::Now() - start;
+		m_replay.endTick(m_tick, duration, m_replay.wantsChecksum(m_tick) ? m_activeScene->checksum() : 0);
+	}
+
+	m_tick++;
+	if (m_replay.finished(m_tick)) { quit(); }
 }
 
 void GameEngine::quit()
@@ -176,4 +364,9 @@ void GameEngine::quit()
 const Assets& GameEngine::assets() const
 {
 	return m_assets;
+}
+
+void GameEngine::waitForAssets()
+{
+	m_assets.finishLoading();
 }
\ No newline at end of file
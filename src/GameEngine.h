@@ -3,10 +3,17 @@
 #include "Common.h"
 #include "Scene.h"
 #include "Assets.h"
+#include "Replay.h"
+#include "FrameArena.h"
+#include "InputState.h"
 
 #include <memory>
+#include <future>
+#include <functional>
 
 typedef std::map<std::string, std::shared_ptr<Scene>> SceneMap;
+typedef std::function<std::shared_ptr<Scene>()> SceneFactory;
+typedef std::map<std::string, std::shared_future<std::shared_ptr<Scene>>> ScenePreloadMap;
 
 class GameEngine
 {
@@ -17,26 +24,78 @@ protected:
 	Assets				m_assets;
 	std::string			m_currentScene;
 	SceneMap			m_sceneMap;
+	Scene*				m_activeScene = nullptr;	// cached m_sceneMap[m_currentScene]
+	ScenePreloadMap		m_preloadedScenes;
+
+	// scene swaps requested during a frame are applied at the start of the next one,
+	// so a scene is never destroyed while one of its own systems is still running
+	struct SceneChange
+	{
+		std::string				name;
+		std::shared_ptr<Scene>	scene;
+		bool					endCurrent = false;
+		bool					pending = false;
+	};
+	SceneChange			m_sceneChange;
+	Replay				m_replay;
+	FrameArena			m_frameArena;
+	InputState			m_input;				// this tick's keyboard and mouse, polled by sUserInput
+	InputEventLog		m_inputLog;
+	size_t				m_tick = 0;				// updates run so far, recordings are keyed by it
 	size_t				m_simulationSpeed = 1;
+	size_t				m_drawCalls = 0;
+	size_t				m_lastDrawCalls = 0;
+	sf::Vector2u		m_windowSize = { 1280, 768 };
 	bool				m_running = true;
+	bool				m_headless = false;		// no window, nothing is uploaded or drawn, see GameEngine(path, headless)
 
 	void init(const std::string& path);
 	void update();
 
 	void sUserInput();
+	void applySceneChange();
 
-	std::shared_ptr<Scene> currentScene();
+	Scene* currentScene();
 
 public:
 
-	GameEngine(const std::string& path);
+	// a headless engine never opens a window, scenes still simulate and build their draw calls
+	// but nothing reaches the GPU, used by the benchmarks and anything else without a display
+	GameEngine(const std::string& path, bool headless = false);
+	~GameEngine();
 
 	void changeScene(const std::string& sceneName, std::shared_ptr<Scene> scene, bool endCurrentScene = false);
+	void preloadScene(const std::string& key, SceneFactory factory);
+	std::shared_ptr<Scene> takePreloadedScene(const std::string& key);
 
 	void quit();
 	void run();
 
+	// record every action sent to the scenes, or play a recording back in place of the keyboard and mouse
+	bool record(const std::string& path);
+	bool replay(const std::string& path);
+	size_t tick() const;
+
+	// records the action when recording and sends it to the current scene
+	void dispatch(const Action& action);
+
+	// when the last input events were polled and used, see InputEventLog
+	const InputEventLog& inputLog() const;
+
 	sf::RenderWindow& window();
+	const sf::Vector2u& windowSize() const;
+	sf::View defaultView() const;		// the window's default view, also valid when headless
+	bool headless() const;
+
+	// scenes clear and draw through these so every draw call is counted
+	void clear(const sf::Color& color);
+	void draw(const sf::Drawable& drawable, const sf::RenderStates& states = sf::RenderStates::Default);
+	void draw(const sf::Vertex* vertices, size_t count, sf::PrimitiveType type, const sf::RenderStates& states = sf::RenderStates::Default);
+	size_t drawCalls() const;
+
+	// scratch memory for the current update, see FrameArena
+	FrameArena& frameArena();
 	const Assets& assets() const;
+	void waitForAssets();
 	bool isRunning();
 };
\ No newline at end of file
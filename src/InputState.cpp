@@ -0,0 +1,124 @@
+#include "InputState.h"
+
+#include <algorithm>
+
+void InputState::begin(size_t newTick)
+{
+	tick = newTick;
+	pressed.reset();
+	released.reset();
+	buttonsPressed.reset();
+	buttonsReleased.reset();
+	mouseMoved = false;
+	firstEvent = 0;
+}
+
+void InputState::keyPressed(int key, long long time)
+{
+	// sf::Keyboard::Unknown and anything out of range has nowhere to go
+	if (key < 0 || key >= sf::Keyboard::KeyCount) { return; }
+
+	// key repeat sends more presses while the key is held, they are not new edges
+	if (!down[key]) { pressed[key] = true; }
+	down[key] = true;
+	if (firstEvent == 0) { firstEvent = time; }
+}
+
+void InputState::keyReleased(int key, long long time)
+{
+	if (key < 0 || key >= sf::Keyboard::KeyCount) { return; }
+
+	released[key] = true;
+	down[key] = false;
+	if (firstEvent == 0) { firstEvent = time; }
+}
+
+void InputState::buttonPressed(int button, const Vec2& pos, long long time)
+{
+	if (button < 0 || button >= sf::Mouse::ButtonCount) { return; }
+
+	buttonsPressed[button] = true;
+	buttonsDown[button] = true;
+	buttonPos[button] = pos;
+	if (firstEvent == 0) { firstEvent = time; }
+}
+
+void InputState::buttonReleased(int button, const Vec2& pos, long long time)
+{
+	if (button < 0 || button >= sf::Mouse::ButtonCount) { return; }
+
+	buttonsReleased[button] = true;
+	buttonsDown[button] = false;
+	buttonPos[button] = pos;
+	if (firstEvent == 0) { firstEvent = time; }
+}
+
+void InputState::mouseMovedTo(const Vec2& pos, long long time)
+{
+	mouse = pos;
+	mouseMoved = true;
+	if (firstEvent == 0) { firstEvent = time; }
+}
+
+bool InputState::any() const
+{
+	return pressed.any() || released.any() || buttonsPressed.any() || buttonsReleased.any() || mouseMoved;
+}
+
+void InputEventLog::record(sf::Event::EventType type, int code, size_t tick, long long time)
+{
+	Event& event = m_events[m_next];
+	event.polled = time;
+	event.consumed = 0;
+	event.tick = tick;
+	event.code = code;
+	event.type = (unsigned char)type;
+
+	m_next = (m_next + 1) % Capacity;
+	if (m_count < Capacity)		{ m_count++; }
+	if (m_pending < Capacity)	{ m_pending++; }
+}
+
+long long InputEventLog::consume(long long time)
+{
+	long long worst = 0;
+	for (size_t i = m_count - m_pending; i < m_count; i++)
+	{
+		Event& event = m_events[(m_next + Capacity - m_count + i) % Capacity];
+		event.consumed = time;
+		worst = std::max(worst, time - event.polled);
+	}
+	m_pending = 0;
+	return worst;
+}
+
+size_t InputEventLog::latency(double& average, double& worst) const
+{
+	average = 0;
+	worst = 0;
+
+	size_t consumed = 0;
+	for (size_t i = 0; i < m_count; i++)
+	{
+		const Event& event = at(i);
+		if (event.consumed == 0) { continue; }
+
+		double milliseconds = (event.consumed - event.polled) / 1000000.0;
+		average += milliseconds;
+		worst = std::max(worst, milliseconds);
+		consumed++;
+	}
+
+	if (consumed > 0) { average /= consumed; }
+	return consumed;
+}
+
+size_t InputEventLog::count() const
+{
+	return m_count;
+}
+
+const InputEventLog::Event& InputEventLog::at(size_t index) const
+{
+	return m_events[(m_next + Capacity - m_count + index) % Capacity];
+}
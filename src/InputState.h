@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+
+#include <bitset>
+#include <array>
+
+// everything the keyboard and mouse did during one tick. The engine polls SFML's events into it
+// and the active scene consumes it once, right before it simulates the tick, see Scene::sInput
+//
+// fixed size, polling allocates nothing. The edges only hold for the tick they happened in,
+// a key tapped inside a single tick has both pressed and released set and is not down
+struct InputState
+{
+	typedef std::bitset<sf::Keyboard::KeyCount>	KeyBits;
+	typedef std::bitset<sf::Mouse::ButtonCount>	ButtonBits;
+
+	size_t		tick			= 0;
+	KeyBits		down;						// held at the end of the tick
+	KeyBits		pressed;					// went down during the tick
+	KeyBits		released;					// went up during the tick
+	ButtonBits	buttonsDown;
+	ButtonBits	buttonsPressed;
+	ButtonBits	buttonsReleased;
+	Vec2		buttonPos[sf::Mouse::ButtonCount];		// where each button last went down or up
+	Vec2		mouse;						// the last position the mouse moved to
+	bool		mouseMoved		= false;
+	long long	firstEvent		= 0;		// when the oldest event of the tick was polled, 0 if there was none
+
+	// starts the next tick, whatever is held stays held
+	void begin(size_t tick);
+
+	void keyPressed(int key, long long time);
+	void keyReleased(int key, long long time);
+	void buttonPressed(int button, const Vec2& pos, long long time);
+	void buttonReleased(int button, const Vec2& pos, long long time);
+	void mouseMovedTo(const Vec2& pos, long long time);
+
+	bool any() const;
+};
+
+// when each of the last Capacity input events was polled and when the tick that used it finished
+// simulating, the difference is the input to simulation latency. Mouse movement is only logged
+// once a tick, its first event, so it does not push the keys out of the ring
+class InputEventLog
+{
+public:
+
+	static const size_t Capacity = 256;
+
+	struct Event
+	{
+		long long		polled		= 0;
+		long long		consumed	= 0;	// 0 until its tick has simulated
+		size_t			tick		= 0;
+		int				code		= 0;	// key or mouse button, -1 for a move
+		unsigned char	type		= 0;	// sf::Event::EventType
+	};
+
+private:
+
+	std::array<Event, Capacity>	m_events;
+	size_t						m_next			= 0;
+	size_t						m_count			= 0;
+	size_t						m_pending		= 0;	// newest events not consumed yet
+
+public:
+
+	void record(sf::Event::EventType type, int code, size_t tick, long long time);
+
+	// stamps every pending event as used by a tick that finished at time
+	// and gives back the longest wait among them in nanoseconds, 0 if there were none
+	long long consume(long long time);
+
+	// average and worst latency in milliseconds over the consumed events still in the ring
+	size_t latency(double& average, double& worst) const;
+
+	size_t count() const;
+	const Event& at(size_t index) const;	// 0 is the oldest
+};
@@ -0,0 +1,312 @@
+#include "LevelFile.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+	uint32_t chunkOf(const LevelFile::LevelRecord& record)
+	{
+		return (uint32_t)std::max(0.0f, std::floor(record.x / LevelFile::ChunkColumns));
+	}
+
+	// groups the records by chunk, keeping file order within a chunk, and builds the chunk table
+	void buildChunks(LevelFile::LevelData& level)
+	{
+		std::stable_sort(level.records.begin(), level.records.end(),
+			[](const LevelFile::LevelRecord& a, const LevelFile::LevelRecord& b) { return chunkOf(a) < chunkOf(b); });
+
+		uint32_t chunkCount = level.records.empty() ? 0 : chunkOf(level.records.back()) + 1;
+		level.chunkStarts.assign(chunkCount + 1, 0);
+
+		size_t r = 0;
+		for (uint32_t c = 0; c <= chunkCount; c++)
+		{
+			while (r < level.records.size() && chunkOf(level.records[r]) < c) { r++; }
+			level.chunkStarts[c] = (uint32_t)r;
+		}
+	}
+
+	// checks the header and the table sizes against the file, then reads the type names, the chunk table
+	// and the player into level. The records are left in the file, the first one is returned, null if
+	// the file is not a level or its tables do not hold together
+	const LevelFile::LevelRecord* readTables(const MappedFile& file, LevelFile::LevelData& level)
+	{
+		using namespace LevelFile;
+
+		const unsigned char* data = file.data();
+		const LevelHeader* header = (const LevelHeader*)data;
+
+		// offsets in 64 bits so counts near the 32 bit limit cannot wrap around the size check
+		uint64_t namesOffset	= sizeof(LevelHeader);
+		uint64_t chunksOffset	= file.size() >= sizeof(LevelHeader) ? namesOffset + header->nameTableSize : 0;
+		uint64_t recordOffset	= file.size() >= sizeof(LevelHeader) ? chunksOffset + ((uint64_t)header->chunkCount + 1) * sizeof(uint32_t) : 0;
+
+		if (file.size() < sizeof(LevelHeader) ||
+			!std::equal(Magic, Magic + 4, header->magic) ||
+			header->version != Version ||
+			header->chunkColumns != ChunkColumns ||
+			recordOffset + (uint64_t)header->recordCount * sizeof(LevelRecord) > file.size() ||
+			(header->nameTableSize > 0 && data[namesOffset + header->nameTableSize - 1] != 0))
+		{
+			return nullptr;
+		}
+
+		const char* names = (const char*)(data + namesOffset);
+		for (uint32_t i = 0, offset = 0; i < header->typeCount && offset < header->nameTableSize; i++)
+		{
+			level.types.emplace_back(names + offset);
+			offset += (uint32_t)level.types.back().size() + 1;
+		}
+
+		const uint32_t* chunks = (const uint32_t*)(data + chunksOffset);
+		level.chunkStarts.assign(chunks, chunks + header->chunkCount + 1);
+
+		// the streamer reads a chunk's records with these as they are, so they have to hold together
+		bool valid = level.chunkStarts.front() == 0 && level.chunkStarts.back() == header->recordCount;
+		for (size_t c = 1; valid && c < level.chunkStarts.size(); c++) { valid = level.chunkStarts[c - 1] <= level.chunkStarts[c]; }
+		if (!valid) { return nullptr; }
+
+		level.hasPlayer = header->hasPlayer != 0;
+		if (level.hasPlayer)
+		{
+			PlayerConfig& p = level.player;
+			const float* f = header->player;
+			p.X = f[0]; p.Y = f[1]; p.CX = f[2]; p.CY = f[3];
+			p.SPEED = f[4]; p.JUMP = f[5]; p.MAXSPEED = f[6]; p.GRAVITY = f[7];
+			p.WEAPON = header->weaponType < level.types.size() ? level.types[header->weaponType] : "";
+		}
+
+		return (const LevelRecord*)(data + recordOffset);
+	}
+}
+
+bool LevelFile::Load(const std::string& path, LevelData& level)
+{
+	char magic[4] = {};
+	std::ifstream(path, std::ios::binary).read(magic, 4);
+	return std::equal(Magic, Magic + 4, magic) ? LoadBinary(path, level) : LoadText(path, level);
+}
+
+bool LevelFile::LoadText(const std::string& path, LevelData& level)
+{
+	PROFILE_FUNCTION();
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Could not open level: " << path << std::endl;
+		return false;
+	}
+
+	level = LevelData();
+	std::unordered_map<std::string, uint16_t> typeIndices;
+	auto typeIndex = [&](const std::string& name)
+	{
+		auto it = typeIndices.find(name);
+		if (it != typeIndices.end()) { return it->second; }
+
+		uint16_t index = (uint16_t)level.types.size();
+		level.types.push_back(name);
+		typeIndices[name] = index;
+		return index;
+	};
+
+	std::string str;
+	while (file >> str)
+	{
+		if (str == "Tile" || str == "Dec")
+		{
+			LevelRecord record = {};
+			record.layer = (str == "Tile") ? Tile : Decoration;
+			file >> str >> record.x >> record.y;
+			record.type = typeIndex(str);
+			level.records.push_back(record);
+		}
+		else if (str == "Player")
+		{
+			PlayerConfig& p = level.player;
+			file >> p.X >> p.Y >> p.CX >> p.CY;
+			file >> p.SPEED >> p.JUMP >> p.MAXSPEED >> p.GRAVITY >> p.WEAPON;
+			level.hasPlayer = true;
+		}
+		else
+		{
+			std::cerr << "Unknown Entity Type: " << str << " " << path << std::endl;
+		}
+	}
+
+	buildChunks(level);
+	return true;
+}
+
+bool LevelFile::LoadBinary(const std::string& path, LevelData& level)
+{
+	PROFILE_FUNCTION();
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		std::cerr << "Could not open level: " << path << std::endl;
+		return false;
+	}
+
+	level = LevelData();
+	const LevelRecord* records = readTables(file, level);
+
+	// the packed arrays are copied out in bulk, nothing is parsed per record
+	bool valid = records != nullptr;
+	if (valid) { level.records.assign(records, records + level.chunkStarts.back()); }
+
+	// LevelStreamer indexes the types with these as they are, so they have to hold together
+	for (size_t r = 0; valid && r < level.records.size(); r++) { valid = level.records[r].type < level.types.size(); }
+	if (!valid)
+	{
+		std::cerr << "Not a valid binary level: " << path << std::endl;
+		level = LevelData();
+		return false;
+	}
+
+	return true;
+}
+
+bool LevelFile::SaveBinary(const std::string& path, const LevelData& source)
+{
+	PROFILE_FUNCTION();
+
+	LevelData level = source;
+	if (level.chunkStarts.empty()) { buildChunks(level); }
+
+	// the weapon is stored as a type so the loader can resolve it like any other animation
+	uint32_t weaponType = 0;
+	if (level.hasPlayer)
+	{
+		auto it = std::find(level.types.begin(), level.types.end(), level.player.WEAPON);
+		weaponType = (uint32_t)(it - level.types.begin());
+		if (it == level.types.end()) { level.types.push_back(level.player.WEAPON); }
+	}
+
+	std::string names;
+	for (auto& type : level.types)
+	{
+		names += type;
+		names += '\0';
+	}
+
+	// keep the chunk table and records 4 byte aligned
+	names.resize((names.size() + 3) & ~size_t(3), '\0');
+
+	LevelHeader header = {};
+	std::copy(Magic, Magic + 4, header.magic);
+	header.version		 = Version;
+	header.typeCount	 = (uint32_t)level.types.size();
+	header.nameTableSize = (uint32_t)names.size();
+	header.chunkColumns	 = ChunkColumns;
+	header.chunkCount	 = (uint32_t)level.chunkCount();
+	header.recordCount	 = (uint32_t)level.records.size();
+	header.hasPlayer	 = level.hasPlayer ? 1 : 0;
+	header.weaponType	 = weaponType;
+
+	const PlayerConfig& p = level.player;
+	float player[8] = { p.X, p.Y, p.CX, p.CY, p.SPEED, p.JUMP, p.MAXSPEED, p.GRAVITY };
+	std::memcpy(header.player, player, sizeof(player));
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	if (!out)
+	{
+		std::cerr << "Could not write level: " << path << std::endl;
+		return false;
+	}
+
+	out.write((const char*)&header, sizeof(header));
+	out.write(names.data(), names.size());
+	out.write((const char*)level.chunkStarts.data(), level.chunkStarts.size() * sizeof(uint32_t));
+	out.write((const char*)level.records.data(), level.records.size() * sizeof(LevelRecord));
+	return (bool)out;
+}
+
+bool LevelFile::Convert(const std::string& textPath, const std::string& binaryPath)
+{
+	LevelData level;
+	if (!LoadText(textPath, level) || !SaveBinary(binaryPath, level)) { return false; }
+
+	std::cout << "Wrote level " << binaryPath << ": " << level.records.size() << " records, "
+			  << level.types.size() << " types, " << level.chunkCount() << " chunks" << std::endl;
+	return true;
+}
+
+bool LevelFile::ChunkedLevel::open(const std::string& path)
+{
+	PROFILE_FUNCTION();
+
+	close();
+
+	char magic[4] = {};
+	std::ifstream(path, std::ios::binary).read(magic, 4);
+	if (!std::equal(Magic, Magic + 4, magic))
+	{
+		// a text level has no chunk table to seek with, it is parsed whole and its records kept
+		if (!LoadText(path, m_level)) { return false; }
+		m_records = m_level.records.data();
+		return true;
+	}
+
+	if (!m_file.open(path))
+	{
+		std::cerr << "Could not open level: " << path << std::endl;
+		return false;
+	}
+
+	m_records = readTables(m_file, m_level);
+	if (!m_records)
+	{
+		std::cerr << "Not a valid binary level: " << path << std::endl;
+		close();
+		return false;
+	}
+	return true;
+}
+
+void LevelFile::ChunkedLevel::close()
+{
+	m_file.close();
+	m_level = LevelData();
+	m_records = nullptr;
+}
+
+const LevelFile::LevelData& LevelFile::ChunkedLevel::tables() const
+{
+	return m_level;
+}
+
+size_t LevelFile::ChunkedLevel::chunkCount() const
+{
+	return m_level.chunkCount();
+}
+
+bool LevelFile::ChunkedLevel::readChunk(size_t chunk, std::vector<LevelRecord>& records) const
+{
+	records.clear();
+	if (chunk >= chunkCount()) { return false; }
+
+	const LevelRecord* first = m_records + m_level.chunkStarts[chunk];
+	const LevelRecord* last	 = m_records + m_level.chunkStarts[chunk + 1];
+	records.assign(first, last);
+
+	// a mapped file has only had its tables checked, a record pointing past the types is dropped with its chunk
+	for (const LevelRecord& record : records)
+	{
+		if (record.type >= m_level.types.size())
+		{
+			records.clear();
+			return false;
+		}
+	}
+	return true;
+}
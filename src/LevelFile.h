@@ -0,0 +1,105 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct PlayerConfig
+{
+	float X, Y, CX, CY, SPEED, MAXSPEED, JUMP, GRAVITY;
+	std::string WEAPON;
+};
+
+// Level data shared by the text (level*.txt) and binary (level*.lvl) formats
+//
+// Binary layout, little endian:
+//   LevelHeader
+//   type name table, nameTableSize bytes of null terminated animation names
+//   chunk table, (chunkCount + 1) uint32 record indices
+//   LevelRecord[recordCount], grouped by chunk
+//
+// records are grouped into chunks of ChunkColumns grid columns so a range of
+// columns can be read without touching the rest of the level
+namespace LevelFile
+{
+	const char		Magic[4]		= { 'S', 'F', 'L', 'V' };
+	const uint32_t	Version			= 1;
+	const uint32_t	ChunkColumns	= 16;
+
+	enum Layer : uint8_t { Tile = 0, Decoration = 1 };
+
+	struct LevelRecord
+	{
+		uint16_t	type;		// index into the level's type name table
+		uint8_t		layer;		// Layer
+		uint8_t		reserved;
+		float		x;			// grid coordinates, decorations may sit between cells
+		float		y;
+	};
+
+	struct LevelHeader
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint32_t	typeCount;
+		uint32_t	nameTableSize;
+		uint32_t	chunkColumns;
+		uint32_t	chunkCount;
+		uint32_t	recordCount;
+		uint32_t	hasPlayer;
+		float		player[8];		// X Y CX CY SPEED JUMP MAXSPEED GRAVITY, same order as the text format
+		uint32_t	weaponType;		// index into the type name table
+		uint32_t	reserved;
+	};
+
+	static_assert(sizeof(LevelRecord) == 12, "level layout must not depend on the compiler");
+	static_assert(sizeof(LevelHeader) == 72, "level layout must not depend on the compiler");
+
+	struct LevelData
+	{
+		bool						hasPlayer = false;
+		PlayerConfig				player = {};
+		std::vector<std::string>	types;
+		std::vector<LevelRecord>	records;
+		std::vector<uint32_t>		chunkStarts;	// records of chunk c are [chunkStarts[c], chunkStarts[c + 1])
+
+		size_t chunkCount() const { return chunkStarts.empty() ? 0 : chunkStarts.size() - 1; }
+	};
+
+	// a level opened for streaming, only the header, the type names and the chunk table are read up front.
+	// A binary level stays mapped and a chunk's records are copied out of the mapping when it is asked
+	// for, a text level cannot be read a chunk at a time so it is parsed whole and keeps its records
+	class ChunkedLevel
+	{
+		MappedFile			m_file;
+		LevelData			m_level;				// everything but the records of a binary level
+		const LevelRecord*	m_records = nullptr;	// into the mapping, or m_level.records for a text level
+
+	public:
+
+		ChunkedLevel() = default;
+		ChunkedLevel(const ChunkedLevel&) = delete;
+		ChunkedLevel& operator = (const ChunkedLevel&) = delete;
+
+		bool open(const std::string& path);
+		void close();
+
+		// the types, the chunk table and the player, records is empty unless the level was text
+		const LevelData& tables() const;
+		size_t chunkCount() const;
+
+		// the records of one chunk, false and none if any is damaged, safe to call from several threads at once
+		bool readChunk(size_t chunk, std::vector<LevelRecord>& records) const;
+	};
+
+	// picks the format from the file contents
+	bool Load(const std::string& path, LevelData& level);
+	bool LoadText(const std::string& path, LevelData& level);
+	bool LoadBinary(const std::string& path, LevelData& level);
+	bool SaveBinary(const std::string& path, const LevelData& level);
+
+	// offline step: SFMLGame --convert-level level1.txt level1.lvl
+	bool Convert(const std::string& textPath, const std::string& binaryPath);
+}
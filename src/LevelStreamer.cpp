@@ -0,0 +1,236 @@
+#include "LevelStreamer.h"
+#include "Assets.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+#include <cstring>
+
+LevelStreamer::LevelStreamer()
+{
+
+}
+
+LevelStreamer::~LevelStreamer()
+{
+	// prepare jobs read our level data, let them finish first
+	for (size_t c : m_resident)
+	{
+		if (m_chunks[c].spawns.valid()) { m_chunks[c].spawns.wait(); }
+	}
+}
+
+bool LevelStreamer::open(const std::string& path, const Assets& assets, const Vec2& gridSize, float height)
+{
+	PROFILE_FUNCTION();
+
+	if (!m_level.open(path)) { return false; }
+
+	m_assets	= &assets;
+	m_gridSize	= gridSize;
+	m_height	= height;
+
+	// resolve each type once, the prepare jobs only ever touch handles
+	m_types.clear();
+	for (auto& name : m_level.tables().types)
+	{
+		m_types.push_back(assets.getAnimationHandle(name));
+	}
+
+	m_chunks = std::vector<Chunk>(m_level.chunkCount());
+	m_resident.clear();
+	m_edits.clear();
+	return true;
+}
+
+LevelStreamer::SpawnVec LevelStreamer::prepareChunk(size_t chunk) const
+{
+	PROFILE_FUNCTION();
+
+	SpawnVec spawns;
+	std::vector<LevelFile::LevelRecord> records;
+	if (!m_level.readChunk(chunk, records)) { return spawns; }
+
+	spawns.reserve(records.size());
+	for (const LevelFile::LevelRecord& record : records)
+	{
+		AnimationHandle animation = m_types[record.type];
+		const Vec2& size = m_assets->getAnimation(animation).getSize();
+
+		// same placement as Scene_Play::gridToMidPixel, bottom left of the animation sits on the grid cell
+		Vec2 pos((record.x * m_gridSize.x) + (size.x / 2), m_height - (record.y * m_gridSize.y) - (size.y / 2));
+
+		spawns.push_back({ record.layer == LevelFile::Tile ? Tag::tile : Tag::decoration, animation, pos, size, record.x, record.y });
+	}
+
+	return spawns;
+}
+
+void LevelStreamer::update(float left, float right, SpawnVec& spawns, std::vector<size_t>& loads, std::vector<size_t>& unloads)
+{
+	if (m_chunks.empty()) { return; }
+
+	PROFILE_FUNCTION();
+
+	const long long lastChunk = (long long)m_chunks.size() - 1;
+	const long long first	  = (long long)std::floor(left / chunkWidth());
+	const long long last	  = (long long)std::floor(right / chunkWidth());
+
+	// unload anything that has fallen too far outside the view
+	for (size_t i = 0; i < m_resident.size();)
+	{
+		long long c = (long long)m_resident[i];
+		if (c >= first - (long long)UnloadChunks && c <= last + (long long)UnloadChunks) { i++; continue; }
+
+		Chunk& chunk = m_chunks[c];
+		if (chunk.state == ChunkState::Active) { unloads.push_back((size_t)c); }
+		if (chunk.spawns.valid()) { chunk.spawns.wait(); chunk.spawns = std::future<SpawnVec>(); }
+		chunk.state = ChunkState::Unloaded;
+
+		m_resident[i] = m_resident.back();
+		m_resident.pop_back();
+	}
+
+	// start preparing chunks that are about to come into view
+	for (long long c = std::max(0ll, first - (long long)PrefetchChunks); c <= std::min(lastChunk, last + (long long)PrefetchChunks); c++)
+	{
+		Chunk& chunk = m_chunks[c];
+		if (chunk.state != ChunkState::Unloaded) { continue; }
+
+		// a changed chunk comes back as it was kept, there is nothing to read
+		chunk.state = ChunkState::Preparing;
+		if (!findEdit((size_t)c))
+		{
+			chunk.spawns = ThreadPool::Instance().submit([this, c]() { return prepareChunk((size_t)c); });
+		}
+		m_resident.push_back((size_t)c);
+	}
+
+	// activate chunks close to the view, this only blocks if the view jumped past the prefetch range
+	for (long long c = std::max(0ll, first - (long long)ActivateChunks); c <= std::min(lastChunk, last + (long long)ActivateChunks); c++)
+	{
+		Chunk& chunk = m_chunks[c];
+		if (chunk.state != ChunkState::Preparing) { continue; }
+
+		// an edit kept while this chunk was being prepared wins over the level file
+		const ChunkEdit* edit = findEdit((size_t)c);
+		if (chunk.spawns.valid())
+		{
+			SpawnVec chunkSpawns = chunk.spawns.get();
+			if (!edit) { spawns.insert(spawns.end(), chunkSpawns.begin(), chunkSpawns.end()); }
+		}
+		if (edit) { spawns.insert(spawns.end(), edit->spawns.begin(), edit->spawns.end()); }
+
+		chunk.state	 = ChunkState::Active;
+		chunk.edited = false;
+		loads.push_back((size_t)c);
+	}
+}
+
+void LevelStreamer::markEdited(size_t chunk)
+{
+	if (chunk < m_chunks.size()) { m_chunks[chunk].edited = true; }
+}
+
+bool LevelStreamer::edited(size_t chunk) const
+{
+	return chunk < m_chunks.size() && m_chunks[chunk].edited;
+}
+
+void LevelStreamer::keepEdit(ChunkEdit&& edit)
+{
+	if (edit.chunk >= m_chunks.size()) { return; }
+
+	m_edits.push_back(std::move(edit));
+}
+
+const LevelStreamer::ChunkEdit* LevelStreamer::findEdit(size_t chunk) const
+{
+	for (size_t i = m_edits.size(); i > 0; i--)
+	{
+		if (m_edits[i - 1].chunk == chunk) { return &m_edits[i - 1]; }
+	}
+	return nullptr;
+}
+
+void LevelStreamer::save(std::vector<uint8_t>& data) const
+{
+	// a byte per chunk, bit 0 spawned and bit 1 changed, then the number of edits kept
+	const uint64_t editCount = m_edits.size();
+	data.assign(m_chunks.size() + sizeof(editCount), 0);
+	for (size_t c : m_resident)
+	{
+		if (m_chunks[c].state == ChunkState::Active) { data[c] |= 1; }
+	}
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		if (m_chunks[c].edited) { data[c] |= 2; }
+	}
+	std::memcpy(data.data() + m_chunks.size(), &editCount, sizeof(editCount));
+}
+
+void LevelStreamer::restore(const std::vector<uint8_t>& data)
+{
+	for (size_t c : m_resident)
+	{
+		Chunk& chunk = m_chunks[c];
+		if (chunk.spawns.valid()) { chunk.spawns.wait(); chunk.spawns = std::future<SpawnVec>(); }
+		chunk.state = ChunkState::Unloaded;
+	}
+	m_resident.clear();
+
+	uint64_t editCount = 0;
+	if (data.size() != m_chunks.size() + sizeof(editCount)) { return; }
+
+	for (size_t c = 0; c < m_chunks.size(); c++)
+	{
+		m_chunks[c].edited = (data[c] & 2) != 0;
+		if (!(data[c] & 1)) { continue; }
+
+		m_chunks[c].state = ChunkState::Active;
+		m_resident.push_back(c);
+	}
+
+	std::memcpy(&editCount, data.data() + m_chunks.size(), sizeof(editCount));
+	if (editCount < m_edits.size()) { m_edits.resize((size_t)editCount); }
+}
+
+const std::vector<LevelStreamer::ChunkEdit>& LevelStreamer::edits() const
+{
+	return m_edits;
+}
+
+void LevelStreamer::restoreEdits(const std::vector<ChunkEdit>& edits)
+{
+	m_edits = edits;
+}
+
+const LevelFile::LevelData& LevelStreamer::level() const
+{
+	return m_level.tables();
+}
+
+float LevelStreamer::chunkWidth() const
+{
+	return LevelFile::ChunkColumns * m_gridSize.x;
+}
+
+size_t LevelStreamer::chunkOf(float leftEdge) const
+{
+	return (size_t)std::max(0.0f, std::floor(leftEdge / chunkWidth()));
+}
+
+size_t LevelStreamer::activeChunks() const
+{
+	size_t count = 0;
+	for (size_t c : m_resident)
+	{
+		if (m_chunks[c].state == ChunkState::Active) { count++; }
+	}
+	return count;
+}
+
+size_t LevelStreamer::residentChunks(float viewWidth) const
+{
+	// everything from UnloadChunks left of the view to UnloadChunks right of it, the view itself can straddle one more
+	return (size_t)std::ceil(viewWidth / chunkWidth()) + 1 + 2 * UnloadChunks;
+}
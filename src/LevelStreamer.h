@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Common.h"
+#include "LevelFile.h"
+#include "AssetHandle.h"
+#include "EntityMemoryPool.h"
+
+#include <future>
+
+class Assets;
+
+// Keeps only the chunks of a level that are near the view instantiated.
+// Chunks are ChunkColumns grid columns wide. Only the level's tables are read
+// when it opens, reading a chunk's records and turning them into spawn data
+// happens on the thread pool ahead of the view, the owning scene then only has
+// to create the entities on the main thread.
+//
+// A chunk the scene changed (a brick broken, a tile dragged away) is kept as
+// the scene hands it over when it unloads, and streams back in like that
+// rather than from the level file.
+class LevelStreamer
+{
+public:
+
+	// everything needed to create one entity on the main thread
+	struct Spawn
+	{
+		Tag				tag;
+		AnimationHandle	animation;
+		Vec2			pos;
+		Vec2			size;
+		float			gridX;			// the record's grid cell, whole numbers unless it sits between cells
+		float			gridY;
+	};
+
+	typedef std::vector<Spawn> SpawnVec;
+
+	// a changed chunk as it was when it unloaded
+	struct ChunkEdit
+	{
+		size_t					chunk = 0;
+		std::vector<uint8_t>	tiles;			// Tilemap::saveChunk
+		SpawnVec				spawns;			// its entities, placed off the grid so they stay entities
+	};
+
+	static const size_t PrefetchChunks	= 2;	// prepare chunks this far outside the view
+	static const size_t ActivateChunks	= 1;	// spawn chunks this far outside the view
+	static const size_t UnloadChunks	= 3;	// destroy chunks further than this outside the view
+
+private:
+
+	enum class ChunkState : unsigned char { Unloaded, Preparing, Active };
+
+	struct Chunk
+	{
+		ChunkState				state = ChunkState::Unloaded;
+		bool					edited = false;		// changed since it last streamed in
+		std::future<SpawnVec>	spawns;
+	};
+
+	LevelFile::ChunkedLevel			m_level;
+	std::vector<AnimationHandle>	m_types;
+	std::vector<Chunk>				m_chunks;
+	std::vector<size_t>				m_resident;		// chunks that are not Unloaded
+	std::vector<ChunkEdit>			m_edits;		// only ever added to, the latest for a chunk is the one that counts
+	const Assets*					m_assets = nullptr;
+	Vec2							m_gridSize;
+	float							m_height = 0;
+
+	SpawnVec prepareChunk(size_t chunk) const;
+
+public:
+
+	LevelStreamer();
+	~LevelStreamer();
+
+	LevelStreamer(const LevelStreamer&) = delete;
+	LevelStreamer& operator = (const LevelStreamer&) = delete;
+
+	// reads the level's tables and resolves its animations, no records are read and no entities are created yet
+	bool open(const std::string& path, const Assets& assets, const Vec2& gridSize, float height);
+
+	// brings chunk states in line with the visible pixel range [left, right]
+	// appends the entities of newly active chunks to spawns and their indices to loads,
+	// and the indices of chunks to destroy to unloads
+	void update(float left, float right, SpawnVec& spawns, std::vector<size_t>& loads, std::vector<size_t>& unloads);
+
+	// the scene changed something in chunk, it is kept when it unloads
+	void markEdited(size_t chunk);
+	bool edited(size_t chunk) const;
+	void keepEdit(ChunkEdit&& edit);
+
+	// the kept state chunk streams back in with, null if it never changed
+	const ChunkEdit* findEdit(size_t chunk) const;
+
+	// which chunks are spawned and changed and how many edits are kept, saved alongside the entities so a
+	// restore agrees with them. Anything being prepared is dropped and prepared again, and edits kept after
+	// the save are dropped, they belong to a future that did not happen
+	void save(std::vector<uint8_t>& data) const;
+	void restore(const std::vector<uint8_t>& data);
+
+	// every edit kept so far, for a save state that is restored after a rewind could have dropped some
+	const std::vector<ChunkEdit>& edits() const;
+	void restoreEdits(const std::vector<ChunkEdit>& edits);
+
+	const LevelFile::LevelData& level() const;
+	float chunkWidth() const;
+	size_t chunkOf(float leftEdge) const;
+	size_t activeChunks() const;
+
+	// the most chunks that can be spawned at once for a view this wide
+	size_t residentChunks(float viewWidth) const;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// a read only memory mapping of a whole file
+// the mapped bytes stay valid until close() or destruction
+class MappedFile
+{
+	const unsigned char*	m_data = nullptr;
+	size_t					m_size = 0;
+	void*					m_file = nullptr;		// windows file / mapping handles, unused elsewhere
+	void*					m_mapping = nullptr;
+
+public:
+
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator = (const MappedFile&) = delete;
+
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const;
+	const unsigned char* data() const;
+	size_t size() const;
+};
@@ -0,0 +1,128 @@
+#include "ParticleSystem.h"
+#include "Animation.h"
+#include "GameEngine.h"
+
+#include <algorithm>
+
+ParticleSystem::Emitter& ParticleSystem::emitter(const Animation& animation)
+{
+	// a scene only ever plays a handful of effects
+	for (Emitter& e : m_emitters)
+	{
+		if (e.animation == animation.getHandle()) { return e; }
+	}
+
+	m_emitters.emplace_back();
+	Emitter& e		= m_emitters.back();
+	e.animation		= animation.getHandle();
+	e.texture		= animation.getSprite().getTexture();
+	e.size			= animation.getSize();
+	e.frameCount	= (uint32_t)std::max<size_t>(animation.getFrameCount(), 1);
+	e.speed			= (uint32_t)animation.getSpeed();
+	e.lifetime		= std::max<uint32_t>((e.frameCount - 1) * e.speed, 1);
+	return e;
+}
+
+bool ParticleSystem::emit(const Animation& animation, const Vec2& pos, const Vec2& velocity)
+{
+	Emitter& e = emitter(animation);
+	if (e.count == e.x.size())
+	{
+		if (e.count == MaxParticles) { return false; }
+
+		// the arrays never shrink, expired slots are reused by the next burst
+		size_t size = std::max<size_t>(e.count * 2, 64);
+		if (size > MaxParticles) { size = MaxParticles; }
+		e.x.resize(size);
+		e.y.resize(size);
+		e.vx.resize(size);
+		e.vy.resize(size);
+		e.age.resize(size);
+	}
+
+	size_t i = e.count++;
+	e.x[i]		= pos.x;
+	e.y[i]		= pos.y;
+	e.vx[i]		= velocity.x;
+	e.vy[i]		= velocity.y;
+	e.age[i]	= 0;
+	return true;
+}
+
+void ParticleSystem::update()
+{
+	for (Emitter& e : m_emitters)
+	{
+		size_t count = e.count;
+		float* x = e.x.data();
+		float* y = e.y.data();
+		const float* vx = e.vx.data();
+		const float* vy = e.vy.data();
+		uint32_t* age = e.age.data();
+
+		// straight loops over plain arrays, the compiler turns these into SIMD
+		for (size_t i = 0; i < count; i++) { x[i] += vx[i]; }
+		for (size_t i = 0; i < count; i++) { y[i] += vy[i]; }
+		for (size_t i = 0; i < count; i++) { age[i]++; }
+
+		// the expired ones are the oldest, all at the front
+		size_t expired = 0;
+		while (expired < count && age[expired] >= e.lifetime) { expired++; }
+		if (expired == 0) { continue; }
+
+		size_t alive = count - expired;
+		std::copy(e.x.begin() + expired, e.x.begin() + count, e.x.begin());
+		std::copy(e.y.begin() + expired, e.y.begin() + count, e.y.begin());
+		std::copy(e.vx.begin() + expired, e.vx.begin() + count, e.vx.begin());
+		std::copy(e.vy.begin() + expired, e.vy.begin() + count, e.vy.begin());
+		std::copy(e.age.begin() + expired, e.age.begin() + count, e.age.begin());
+		e.count = alive;
+	}
+}
+
+void ParticleSystem::clear()
+{
+	for (Emitter& e : m_emitters) { e.count = 0; }
+}
+
+size_t ParticleSystem::count() const
+{
+	size_t total = 0;
+	for (const Emitter& e : m_emitters) { total += e.count; }
+	return total;
+}
+
+void ParticleSystem::draw(GameEngine* game, const sf::View& view)
+{
+	float left		= view.getCenter().x - view.getSize().x / 2;
+	float right		= view.getCenter().x + view.getSize().x / 2;
+	float top		= view.getCenter().y - view.getSize().y / 2;
+	float bottom	= view.getCenter().y + view.getSize().y / 2;
+
+	for (const Emitter& e : m_emitters)
+	{
+		if (e.count == 0) { continue; }
+
+		m_vertices.clear();
+		float hw = e.size.x / 2;
+		float hh = e.size.y / 2;
+		for (size_t i = 0; i < e.count; i++)
+		{
+			if (e.x[i] + hw < left || e.x[i] - hw > right || e.y[i] + hh < top || e.y[i] - hh > bottom) { continue; }
+
+			// the frames sit side by side in the texture, like CAnimation::frame
+			uint32_t frame = e.speed > 0 ? (e.age[i] / e.speed) % e.frameCount : 0;
+			float u = frame * e.size.x;
+
+			m_vertices.emplace_back(sf::Vector2f(e.x[i] - hw, e.y[i] - hh), sf::Vector2f(u, 0));
+			m_vertices.emplace_back(sf::Vector2f(e.x[i] + hw, e.y[i] - hh), sf::Vector2f(u + e.size.x, 0));
+			m_vertices.emplace_back(sf::Vector2f(e.x[i] + hw, e.y[i] + hh), sf::Vector2f(u + e.size.x, e.size.y));
+			m_vertices.emplace_back(sf::Vector2f(e.x[i] - hw, e.y[i] + hh), sf::Vector2f(u, e.size.y));
+		}
+		if (m_vertices.empty()) { continue; }
+
+		sf::RenderStates states;
+		states.texture = e.texture;
+		game->draw(m_vertices.data(), m_vertices.size(), sf::Quads, states);
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Common.h"
+#include "AssetHandle.h"
+
+#include <vector>
+#include <cstdint>
+
+class Animation;
+class GameEngine;
+
+// effects that only play an animation out and never collide, like the explosion of a brick or the coin
+// out of a question block. They are not entities, so a burst of them costs the ECS and sCollision nothing
+//
+// one emitter per animation, its particles are structure of arrays that grow to the largest burst seen
+// and are then reused, so a steady stream of effects never allocates. Every particle of an emitter lives
+// the same number of ticks and they are appended as they spawn, so the oldest are always at the front
+// and the ones that expire are dropped as one run
+//
+// all of an emitter's particles share a texture and are drawn as a single batch of quads
+class ParticleSystem
+{
+public:
+
+	static const size_t MaxParticles = 65536;		// per emitter, a burst past it is dropped
+
+private:
+
+	struct Emitter
+	{
+		AnimationHandle			animation;
+		const sf::Texture*		texture		= nullptr;
+		Vec2					size;
+		uint32_t				frameCount	= 1;
+		uint32_t				speed		= 0;
+		uint32_t				lifetime	= 1;	// ticks until the animation has played once
+		size_t					count		= 0;
+
+		std::vector<float>		x, y, vx, vy;
+		std::vector<uint32_t>	age;
+	};
+
+	std::vector<Emitter>		m_emitters;
+	std::vector<sf::Vertex>		m_vertices;		// rebuilt by every draw
+
+	Emitter& emitter(const Animation& animation);
+
+public:
+
+	// starts animation at pos, false if its emitter is full
+	bool emit(const Animation& animation, const Vec2& pos, const Vec2& velocity = Vec2(0, 0));
+
+	// moves and ages every particle a tick and drops the ones whose animation has ended
+	void update();
+
+	void clear();
+	size_t count() const;
+
+	// draws the particles inside the view, one draw call per emitter that has any
+	void draw(GameEngine* game, const sf::View& view);
+};
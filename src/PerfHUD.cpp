@@ -0,0 +1,76 @@
+#include "PerfHUD.h"
+#include "GameEngine.h"
+#include "EntityManager.h"
+#include "Tilemap.h"
+
+#include <cstdio>
+
+void PerfHUD::init(const sf::Font& font)
+{
+	m_text.setFont(font);
+	m_text.setCharacterSize(14);
+	m_text.setFillColor(sf::Color::White);
+	m_text.setPosition(sf::Vector2f(10, 10));
+
+	m_background.setFillColor(sf::Color(0, 0, 0, 160));
+	m_background.setPosition(sf::Vector2f(5, 5));
+	m_background.setSize(sf::Vector2f(420, 18 * (Rows + 9)));
+}
+
+size_t PerfHUD::printScope(size_t offset, const ProfileStats::Summary& summary)
+{
+	int written = std::snprintf(m_buffer + offset, sizeof(m_buffer) - offset, "%-24.24s %7.3f   p50 %7.3f   p99 %7.3f\n",
+		summary.name, summary.average, summary.p50, summary.p99);
+	return written > 0 ? std::min(offset + written, sizeof(m_buffer) - 1) : offset;
+}
+
+void PerfHUD::draw(GameEngine* game, EntityManager& entityManager, const Tilemap& tilemap, size_t bullets)
+{
+	PROFILE_FUNCTION();
+
+	if (m_framesUntilRefresh-- == 0)
+	{
+		m_framesUntilRefresh = RefreshFrames;
+
+		const ProfileStats& stats = Profiler::Instance().stats();
+		size_t offset = 0;
+
+		// the frame split first, then whatever costs the most
+		for (const char* name : { "Frame", "Simulate", "Render" })
+		{
+			ProfileStats::Summary summary;
+			summary.name = name;
+			stats.find(name, summary);
+			offset = printScope(offset, summary);
+		}
+		offset += std::snprintf(m_buffer + offset, sizeof(m_buffer) - offset, "\n");
+
+		ProfileStats::Summary top[Rows];
+		size_t count = stats.top(top, Rows);
+		for (size_t i = 0; i < count; i++)
+		{
+			offset = printScope(offset, top[i]);
+		}
+
+		double latency, worstLatency;
+		size_t events = game->inputLog().latency(latency, worstLatency);
+
+		const EntityMemoryPool& pool = EntityMemoryPool::Instance();
+		std::snprintf(m_buffer + offset, sizeof(m_buffer) - offset, "\nentities %zu   tiles %zu   decorations %zu   bullets %zu   draws %zu\npool %zu / %zu in %zu pages   peak %zu\ninput latency %.3f ms   worst %.3f   over %zu events",
+			entityManager.getTotal(),
+			entityManager.getEntities(Tag::tile).size() + tilemap.count(LevelFile::Tile),
+			entityManager.getEntities(Tag::decoration).size() + tilemap.count(LevelFile::Decoration),
+			bullets,
+			game->drawCalls(),
+			pool.allocatedCount(), pool.capacity(), pool.pageCount(), pool.peakAllocated(),
+			latency, worstLatency, events);
+
+		m_text.setString(m_buffer);
+	}
+
+	sf::View view = game->window().getView();
+	game->window().setView(game->defaultView());
+	game->draw(m_background);
+	game->draw(m_text);
+	game->window().setView(view);
+}
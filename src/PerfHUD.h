@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Common.h"
+#include "ProfileStats.h"
+
+class GameEngine;
+class EntityManager;
+class Tilemap;
+
+// the performance overlay toggled in Scene_Play, every timing comes from Profiler::stats()
+class PerfHUD
+{
+	static const size_t Rows			= 12;	// most expensive scopes listed under the frame split
+	static const size_t RefreshFrames	= 15;	// the text itself is not free, rebuild it a few times a second
+
+	sf::Text			m_text;
+	sf::RectangleShape	m_background;
+	char				m_buffer[2048];
+	size_t				m_framesUntilRefresh = 0;
+
+	size_t printScope(size_t offset, const ProfileStats::Summary& summary);
+
+public:
+
+	void init(const sf::Font& font);
+	void draw(GameEngine* game, EntityManager& entityManager, const Tilemap& tilemap, size_t bullets);
+};
@@ -34,12 +34,19 @@ Vec2 Physics::GetPreviousOverlap(Entity a, Entity b)
 	return Vec2(boxSize.x - delta.x, boxSize.y - delta.y);
 }
 
+Vec2 Physics::GetOverlap(const Vec2& aPos, const Vec2& aHalfSize, const Vec2& bPos, const Vec2& bHalfSize)
+{
+	Vec2 delta = (aPos - bPos).abs();
+	Vec2 boxSize = aHalfSize + bHalfSize;
+	return Vec2(boxSize.x - delta.x, boxSize.y - delta.y);
+}
+
 bool Physics::IsInside(const Vec2& pos, Entity e)
 {
 	// if the entity doesn't have an animation, we can't be 'inside' it
 	if (!e.hasComponent<CAnimation>()) { return false; }
 
-	auto halfSize = e.getComponent<CAnimation>().animation.getSize() / 2;
+	auto halfSize = e.getComponent<CAnimation>().size / 2;
 	
 	// determine the delta vector (distance) between both entities
 	Vec2 delta = (e.getComponent<CTransform>().pos - pos).abs();
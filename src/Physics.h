@@ -7,5 +7,8 @@ namespace Physics
 {
 	Vec2 GetOverlap(Entity a, Entity b);
 	Vec2 GetPreviousOverlap(Entity a, Entity b);
+
+	// the same overlap for boxes that are not entities, like the tiles of a Tilemap
+	Vec2 GetOverlap(const Vec2& aPos, const Vec2& aHalfSize, const Vec2& bPos, const Vec2& bHalfSize);
 	bool IsInside(const Vec2& pos, Entity e);
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "ProfileStats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const float MinBucket = 0.001f;		// 1us in milliseconds
+	const float BucketRatio = std::pow(100000.0f, 1.0f / (ProfileStats::Buckets - 1));
+}
+
+size_t ProfileStats::BucketOf(float milliseconds)
+{
+	if (milliseconds <= MinBucket) { return 0; }
+
+	size_t bucket = (size_t)std::ceil(std::log(milliseconds / MinBucket) / std::log(BucketRatio));
+	return std::min(bucket, Buckets - 1);
+}
+
+float ProfileStats::BucketValue(size_t bucket)
+{
+	// the upper edge, so a percentile never reads lower than the samples behind it
+	return bucket == 0 ? 0.0f : MinBucket * std::pow(BucketRatio, (float)bucket);
+}
+
+void ProfileStats::record(const char* name, long long duration)
+{
+	// names are stable pointers, so the pointer itself is the key
+	size_t slot = (((size_t)name >> 3) * 0x9E3779B97F4A7C15ull) & (MaxScopes - 1);
+	for (size_t probe = 0; probe < MaxScopes; probe++, slot = (slot + 1) & (MaxScopes - 1))
+	{
+		Scope& scope = m_scopes[slot];
+		if (scope.name == name)
+		{
+			scope.frameTotal += duration;
+			return;
+		}
+		if (scope.name == nullptr)
+		{
+			scope.name = name;
+			scope.frameTotal = duration;
+			m_used[m_usedCount++] = (uint8_t)slot;
+			return;
+		}
+	}
+}
+
+void ProfileStats::endFrame()
+{
+	for (size_t i = 0; i < m_usedCount; i++)
+	{
+		Scope& scope = m_scopes[m_used[i]];
+
+		// a full window drops its oldest sample, which sits in the slot we are about to reuse
+		if (scope.count == Window)
+		{
+			scope.histogram[scope.sampleBuckets[m_frame]]--;
+			scope.sum -= scope.samples[m_frame];
+		}
+		else
+		{
+			scope.count++;
+		}
+
+		float milliseconds = scope.frameTotal / 1000000.0f;
+		size_t bucket = BucketOf(milliseconds);
+		scope.samples[m_frame] = milliseconds;
+		scope.sampleBuckets[m_frame] = (uint8_t)bucket;
+		scope.histogram[bucket]++;
+		scope.sum += milliseconds;
+		scope.runSum += milliseconds;
+		scope.runFrames++;
+		scope.worst = std::max(scope.worst, milliseconds);
+		scope.frameTotal = 0;
+	}
+
+	m_frame = (m_frame + 1) % Window;
+}
+
+void ProfileStats::reset()
+{
+	for (size_t i = 0; i < m_usedCount; i++)
+	{
+		m_scopes[m_used[i]] = Scope();
+	}
+	m_usedCount = 0;
+	m_frame = 0;
+}
+
+ProfileStats::Summary ProfileStats::summarize(const Scope& scope) const
+{
+	Summary summary;
+	summary.name = scope.name;
+	if (scope.count == 0) { return summary; }
+
+	summary.frames = scope.runFrames;
+	summary.runAverage = (float)(scope.runSum / scope.runFrames);
+	summary.worst = scope.worst;
+
+	summary.average = (float)(scope.sum / scope.count);
+
+	size_t p50 = (scope.count * 50 + 99) / 100;
+	size_t p99 = (scope.count * 99 + 99) / 100;
+	size_t seen = 0;
+	for (size_t b = 0; b < Buckets; b++)
+	{
+		size_t before = seen;
+		seen += scope.histogram[b];
+		if (before < p50 && seen >= p50) { summary.p50 = BucketValue(b); }
+		if (before < p99 && seen >= p99) { summary.p99 = BucketValue(b); break; }
+	}
+
+	return summary;
+}
+
+bool ProfileStats::find(const char* name, Summary& summary) const
+{
+	for (size_t i = 0; i < m_usedCount; i++)
+	{
+		const Scope& scope = m_scopes[m_used[i]];
+		if (std::strcmp(scope.name, name) == 0)
+		{
+			summary = summarize(scope);
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t ProfileStats::top(Summary* summaries, size_t max) const
+{
+	std::array<Summary, MaxScopes> all;
+	for (size_t i = 0; i < m_usedCount; i++)
+	{
+		all[i] = summarize(m_scopes[m_used[i]]);
+	}
+
+	size_t count = std::min(max, m_usedCount);
+	std::partial_sort(all.begin(), all.begin() + count, all.begin() + m_usedCount,
+		[](const Summary& a, const Summary& b) { return a.average > b.average; });
+	std::copy(all.begin(), all.begin() + count, summaries);
+	return count;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+// rolling per scope timings for the performance HUD, fed by every scope that finishes on the main thread
+// everything is fixed size, recording a scope or closing a frame never allocates
+class ProfileStats
+{
+public:
+
+	static const size_t MaxScopes	= 128;		// power of two, scopes past this are not tracked
+	static const size_t Window		= 120;		// frames, 2 seconds at 60 fps
+	static const size_t Buckets		= 64;		// log spaced from 1us to 100ms
+
+	struct Summary
+	{
+		const char*	name	= nullptr;
+		float		average	= 0;		// milliseconds per frame over the window
+		float		p50		= 0;
+		float		p99		= 0;
+
+		// every frame since the last reset, not just the window
+		size_t		frames		= 0;
+		float		runAverage	= 0;
+		float		worst		= 0;
+	};
+
+private:
+
+	struct Scope
+	{
+		const char*	name = nullptr;
+		long long	frameTotal = 0;					// nanoseconds recorded so far this frame
+		float		samples[Window] = {};			// milliseconds per frame, indexed like m_frame
+		uint8_t		sampleBuckets[Window] = {};
+		uint16_t	histogram[Buckets] = {};
+		double		sum = 0;
+		size_t		count = 0;
+		double		runSum = 0;
+		size_t		runFrames = 0;
+		float		worst = 0;
+	};
+
+	std::array<Scope, MaxScopes>	m_scopes;
+	std::array<uint8_t, MaxScopes>	m_used;			// slots in use, in the order they were first seen
+	size_t							m_usedCount = 0;
+	size_t							m_frame = 0;	// window slot the current frame writes
+
+	static size_t BucketOf(float milliseconds);
+	static float BucketValue(size_t bucket);
+
+	Summary summarize(const Scope& scope) const;
+
+public:
+
+	void record(const char* name, long long duration);
+	void endFrame();
+	void reset();
+
+	// looks a scope up by its text, the same name can live at different addresses in each translation unit
+	bool find(const char* name, Summary& summary) const;
+
+	// fills summaries with the most expensive scopes first, returns how many were written
+	size_t top(Summary* summaries, size_t max) const;
+};
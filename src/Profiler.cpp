@@ -0,0 +1,185 @@
+#include "Profiler.h"
+
+#include <iostream>
+
+Profiler::Profiler()
+{
+	m_flushThread = std::thread(&Profiler::flushLoop, this);
+}
+
+Profiler::~Profiler()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_flushLock);
+		m_stopping = true;
+	}
+	m_flushCondition.notify_all();
+	m_flushThread.join();
+
+	// anything recorded after the last pass
+	flush();
+
+	for (auto& buffer : m_buffers)
+	{
+		if (buffer->dropped() > 0)
+		{
+			std::cerr << "Profiler: thread " << buffer->threadID() << " dropped " << buffer->dropped() << " scopes\n";
+		}
+	}
+}
+
+ProfileBuffer* Profiler::registerThread()
+{
+	std::lock_guard<std::mutex> lock(m_bufferLock);
+	m_buffers.push_back(std::make_unique<ProfileBuffer>(m_buffers.size()));
+	return m_buffers.back().get();
+}
+
+const char* Profiler::intern(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(m_nameLock);
+	return m_names.insert(name).first->c_str();
+}
+
+void Profiler::flushLoop()
+{
+	std::unique_lock<std::mutex> lock(m_flushLock);
+	while (!m_stopping)
+	{
+		// often enough that a busy thread never fills its ring between passes
+		m_flushCondition.wait_for(lock, std::chrono::milliseconds(10));
+
+		lock.unlock();
+		flush();
+		lock.lock();
+	}
+}
+
+void Profiler::flush()
+{
+	std::lock_guard<std::mutex> writerLock(m_writerLock);
+
+	// threads may register while we write, so work from a copy of the list
+	std::vector<ProfileBuffer*> buffers;
+	{
+		std::lock_guard<std::mutex> lock(m_bufferLock);
+		for (auto& buffer : m_buffers) { buffers.push_back(buffer.get()); }
+	}
+
+	for (ProfileBuffer* buffer : buffers)
+	{
+		size_t threadID = buffer->threadID();
+		buffer->drain([&](const ProfileRecord& record)
+		{
+			if (record.kind == ProfileRecord::Counter)	{ m_writer.counter(record.name, record.start, record.end); }
+			else										{ m_writer.scope(threadID, record.name, record.start, record.end); }
+		});
+	}
+
+	// one chunk per pass, so a crash loses at most the last few milliseconds
+	m_writer.flush();
+}
+
+void Profiler::rearm()
+{
+	bool capturing = m_framesLeft > 0 || m_slowFrameTime > 0 || m_captureAll;
+
+	// the trace is only created once there is something to put in it
+	if (capturing && !m_writerOpen)
+	{
+		std::lock_guard<std::mutex> lock(m_writerLock);
+		m_writerOpen = true;
+		if (!m_writer.open(m_outputFile))
+		{
+			std::cerr << "Profiler: could not open " << m_outputFile << std::endl;
+		}
+	}
+
+	bool armed = capturing || m_statsEnabled || m_allocations.mode() != AllocationTracker::Off;
+	if (!armed) { m_frameStart = 0; }
+
+	s_capturing.store(capturing, std::memory_order_relaxed);
+	s_armed.store(armed, std::memory_order_relaxed);
+}
+
+void Profiler::captureFrames(size_t frames)
+{
+	std::cout << "Profiler: capturing " << frames << " frames to " << m_outputFile << std::endl;
+	m_framesLeft = frames;
+	rearm();
+}
+
+void Profiler::captureSlowFrames(float milliseconds)
+{
+	// every frame is recorded but only committed once we know how long it took
+	m_slowFrameTime = (long long)(milliseconds * 1000000.0f);
+	ThreadBuffer().setDeferred(m_slowFrameTime > 0);
+	rearm();
+}
+
+void Profiler::captureAll()
+{
+	m_captureAll = true;
+	rearm();
+}
+
+void Profiler::enableStats(bool enabled)
+{
+	if (enabled && !m_statsEnabled) { m_stats.reset(); }
+
+	m_statsEnabled = enabled;
+	t_stats = enabled ? &m_stats : nullptr;
+	rearm();
+}
+
+bool Profiler::statsEnabled() const
+{
+	return m_statsEnabled;
+}
+
+const ProfileStats& Profiler::stats() const
+{
+	return m_stats;
+}
+
+void Profiler::trackAllocations(AllocationTracker::Mode mode)
+{
+	// scopes have to run for allocations to be attributed to them
+	m_allocations.setMode(mode);
+	rearm();
+}
+
+const AllocationTracker& Profiler::allocations() const
+{
+	return m_allocations;
+}
+
+void Profiler::beginFrame()
+{
+	if (!IsArmed()) { return; }
+
+	long long now = Now();
+
+	if (m_statsEnabled)
+	{
+		if (m_frameStart > 0) { m_stats.record("Frame", now - m_frameStart); }
+		m_stats.endFrame();
+	}
+
+	m_allocations.endFrame();
+
+	// settle the frame that just finished, only the main thread's ring is deferred
+	// worker scopes span frames so they are always kept
+	if (m_slowFrameTime > 0)
+	{
+		bool slow = m_frameStart > 0 && now - m_frameStart >= m_slowFrameTime;
+		ThreadBuffer().commit(slow || m_framesLeft > 0 || m_captureAll);
+	}
+	m_frameStart = now;
+
+	if (m_framesLeft > 0 && --m_framesLeft == 0)
+	{
+		std::cout << "Profiler: capture finished" << std::endl;
+		rearm();
+	}
+}
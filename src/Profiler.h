@@ -1,11 +1,19 @@
 #pragma once
 
 #include <chrono>
+#include <atomic>
 #include <fstream>
 #include <mutex>
-#include <map>
+#include <condition_variable>
+#include <memory>
 #include <string>
-#include <algorithm>
+#include <vector>
+#include <unordered_set>
+#include <thread>
+
+#include "TraceFile.h"
+#include "ProfileStats.h"
+#include "AllocationTracker.h"
 
 #define PROFILING 1
 #ifdef PROFILING
@@ -13,119 +21,227 @@
 		ProfileTimer timer##__LINE__(name)
 #define PROFILE_FUNCTION() \
 		PROFILE_SCOPE(__FUNCTION__);
+// for names built at runtime (asset paths), the string is only built and interned while armed
+#define PROFILE_SCOPE_DYNAMIC(name) \
+		ProfileTimer timer##__LINE__(Profiler::IsArmed() ? Profiler::Instance().intern(name) : nullptr)
+#define PROFILE_COUNTER(name, value) \
+		do { if (Profiler::IsCapturing()) { Profiler::Counter(name, (long long)(value)); } } while (0)
 #else
 #define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_SCOPE_DYNAMIC(name)
+#define PROFILE_COUNTER(name, value)
 #endif
 
-struct ProfileResult
+// one timed scope or counter sample, the name is never copied so it has to outlive the profiler
+// string literals and __FUNCTION__ do, anything built at runtime goes through Profiler::intern
+struct ProfileRecord
 {
-	std::string name = "Default";
-	long long	start = 0;
-	long long	end = 0;
-	size_t		threadID = 0;
+	enum Kind : unsigned char { Scope, Counter };
+
+	const char*	name  = nullptr;
+	long long	start = 0;		// nanoseconds on the steady clock
+	long long	end   = 0;		// the sampled value for a counter
+	Kind		kind  = Scope;
 };
 
-class Profiler
+// a ring with a single producer (the thread that owns it) and a single consumer (the flush thread)
+// neither side ever waits on the other, if the ring is full the newest scope is dropped
+// a deferred ring only hands records to the flush thread once the owner commits them,
+// which lets the main thread throw away a whole frame that turned out not to be slow
+class ProfileBuffer
 {
-	std::string		m_outputFile = "results.json";
-	size_t			m_profileCount = 0;
-	std::ofstream	m_outputStream;
-	std::mutex		m_lock;
+public:
 
-	Profiler()
-	{
-		m_outputStream = std::ofstream(m_outputFile);
-		writeHeader();
-	}
+	static const size_t Capacity = 1 << 14;
+
+private:
 
-	void writeHeader() { m_outputStream << "{\"otherData\":{},\"traceEvents\":["; }
-	void writeFooter() { m_outputStream << "]}"; }
+	ProfileRecord		m_records[Capacity];
+	size_t				m_head = 0;			// next slot the owning thread writes, private to it
+	std::atomic<size_t>	m_commit{ 0 };		// records before this are visible to the flush thread
+	std::atomic<size_t>	m_tail{ 0 };		// next slot the flush thread reads
+	std::atomic<size_t>	m_dropped{ 0 };
+	size_t				m_threadID;
+	bool				m_deferred = false;
 
 public:
 
-	static Profiler& Instance()
+	ProfileBuffer(size_t threadID)
+		: m_threadID(threadID)
 	{
-		static Profiler instance;
-		return instance;
 	}
 
-	~Profiler()
+	void push(const ProfileRecord& record)
+	{
+		if (m_head - m_tail.load(std::memory_order_acquire) == Capacity)
+		{
+			m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+
+		m_records[m_head & (Capacity - 1)] = record;
+		m_head++;
+		if (!m_deferred) { m_commit.store(m_head, std::memory_order_release); }
+	}
+
+	// the owning thread keeps or discards everything pushed since the last commit
+	void setDeferred(bool deferred) { m_deferred = deferred; commit(true); }
+	void commit(bool keep)
 	{
-		writeFooter();
+		if (keep)	{ m_commit.store(m_head, std::memory_order_release); }
+		else		{ m_head = m_commit.load(std::memory_order_relaxed); }
 	}
 
-	void writeProfile(const ProfileResult& result)
+	// hands every record written so far to fn, only ever called from the flush thread
+	template <typename F>
+	size_t drain(F&& fn)
 	{
-		std::lock_guard<std::mutex> lock(m_lock);
-
-		if (m_profileCount++ > 0) { m_outputStream << ","; }
-
-		std::string name = result.name;
-		std::replace(name.begin(), name.end(), '"', '\'');
-
-		m_outputStream << "\n{";
-		m_outputStream << "\"cat\":\"function\",";
-		m_outputStream << "\"dur\":" << (result.end - result.start) << ',';
-		m_outputStream << "\"name\":\"" << name << "\",";
-		m_outputStream << "\"ph\":\"X\",";
-		m_outputStream << "\"pid\":0,";
-		m_outputStream << "\"tid\":" << result.threadID << ",";
-		m_outputStream << "\"ts\":" << result.start;
-		m_outputStream << "}";
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t head = m_commit.load(std::memory_order_acquire);
+
+		for (size_t i = tail; i != head; i++)
+		{
+			fn(m_records[i & (Capacity - 1)]);
+		}
+
+		m_tail.store(head, std::memory_order_release);
+		return head - tail;
 	}
+
+	size_t threadID() const { return m_threadID; }
+	size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
 };
 
-class ProfileTimer
+class Profiler
 {
-	typedef std::chrono::time_point<std::chrono::high_resolution_clock> ClockType;
+	std::string			m_outputFile = "results.trace";	// convert with --export-trace
+	TraceFile::Writer	m_writer;
+	std::mutex			m_writerLock;
+	bool				m_writerOpen = false;
+
+	// every scope checks this one flag, nothing else is touched while disarmed
+	// armed means either capturing into the trace or collecting stats for the HUD
+	static inline std::atomic<bool> s_armed{ false };
+	static inline std::atomic<bool> s_capturing{ false };
+
+	// only the thread that enabled stats (the main thread) feeds them
+	static inline thread_local ProfileStats* t_stats = nullptr;
+	ProfileStats	m_stats;
+	bool			m_statsEnabled = false;
+
+	AllocationTracker	m_allocations;
+
+	// capture state, only used from the main thread
+	size_t		m_framesLeft = 0;		// frames left in the current F9 / --profile-frames window
+	long long	m_slowFrameTime = 0;	// keep frames at least this long (ns), 0 when off
+	bool		m_captureAll = false;
+	long long	m_frameStart = 0;
+
+	// buffers are owned here rather than by their threads so nothing is lost when a thread exits
+	std::vector<std::unique_ptr<ProfileBuffer>>	m_buffers;
+	std::mutex									m_bufferLock;	// only taken the first time a thread records a scope
+
+	std::unordered_set<std::string>	m_names;
+	std::mutex						m_nameLock;
+
+	std::thread				m_flushThread;
+	std::mutex				m_flushLock;
+	std::condition_variable	m_flushCondition;
+	bool					m_stopping = false;
+
+	Profiler();
 
-	ClockType		m_startTimePoint;
-	ProfileResult	m_result;
-	bool			m_stopped = false;
+	ProfileBuffer* registerThread();
+	void flushLoop();
+	void flush();
+	void rearm();
 
 public:
-	ProfileTimer(const std::string& name)
-		: m_result({ name, 0, 0, 0 })
+
+	static const size_t HotkeyFrames = 300;	// 5 seconds at 60 fps
+
+	static Profiler& Instance()
 	{
-		start();
+		static Profiler instance;
+		return instance;
 	}
 
-	~ProfileTimer()
+	~Profiler();
+
+	static ProfileBuffer& ThreadBuffer()
 	{
-		stop();
+		thread_local ProfileBuffer* buffer = Instance().registerThread();
+		return *buffer;
 	}
 
-	// this function is used to set the start time
-	// it adds 1 time unit if it's the same start time as the previous start time
-	// this solves a display issue in chrome://tracing for identical start times
-	// this is a 2/10 on the janky fix scale but it has worked for me in practive
-	void start()
+	static long long Now()
 	{
-		// a static variable to store the last start time recorded
-		static long long lastStartTime = 0;
-
-		m_startTimePoint = std::chrono::high_resolution_clock::now();
-		m_result.start = std::chrono::time_point_cast<std::chrono::microseconds>(m_startTimePoint).time_since_epoch().count();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
 
-		// if it's the same as the previous start time, add 1 to it
-		m_result.start += (m_result.start == lastStartTime ? 1 : 0);
+	static bool IsArmed()
+	{
+		return s_armed.load(std::memory_order_relaxed);
+	}
 
-		// record the fixed time as the previous start time
-		lastStartTime = m_result.start;
+	static bool IsCapturing()
+	{
+		return s_capturing.load(std::memory_order_relaxed);
+	}
 
-		m_stopped = false;
+	static void Record(const char* name, long long start, long long end)
+	{
+		if (IsCapturing()) { ThreadBuffer().push({ name, start, end, ProfileRecord::Scope }); }
+		if (t_stats) { t_stats->record(name, end - start); }
 	}
 
-	void stop()
+	// a sampled value (entities, draw calls, ...) shown as a graph alongside the scopes
+	static void Counter(const char* name, long long value)
 	{
-		if (m_stopped) { return; }
+		ThreadBuffer().push({ name, Now(), value, ProfileRecord::Counter });
+	}
 
-		auto endTimepoint = std::chrono::high_resolution_clock::now();
+	const char* intern(const std::string& name);
+
+	// these are called from the main thread, which is the one whose frames are measured
+	void captureFrames(size_t frames);
+	void captureSlowFrames(float milliseconds);
+	void captureAll();
+	void enableStats(bool enabled);
+	bool statsEnabled() const;
+	const ProfileStats& stats() const;
+	void trackAllocations(AllocationTracker::Mode mode);
+	const AllocationTracker& allocations() const;
+	void beginFrame();
+};
 
-		m_result.end = std::chrono::time_point_cast<std::chrono::microseconds>(endTimepoint).time_since_epoch().count();
-		m_result.threadID = std::hash<std::thread::id>{}(std::this_thread::get_id());
-		Profiler::Instance().writeProfile(m_result);
+class ProfileTimer
+{
+	const char*	m_name = nullptr;
+	const char*	m_parent = nullptr;		// the enclosing scope, for allocation tracking
+	long long	m_start = 0;
+
+public:
 
-		m_stopped = true;
+	ProfileTimer(const char* name)
+	{
+		// while the profiler is disarmed this branch is the whole cost of a scope
+		// a dynamic scope passes no name at all when it was disarmed
+		if (name && Profiler::IsArmed())
+		{
+			m_name = name;
+			m_parent = AllocationTracker::EnterScope(name);
+			m_start = Profiler::Now();
+		}
+	}
+
+	~ProfileTimer()
+	{
+		if (m_name)
+		{
+			Profiler::Record(m_name, m_start, Profiler::Now());
+			AllocationTracker::LeaveScope(m_parent);
+		}
 	}
-};
\ No newline at end of file
+};
@@ -0,0 +1,344 @@
+#include "ProjectilePool.h"
+#include "GameEngine.h"
+#include "Components.h"
+
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cmath>
+
+namespace
+{
+	// a tile dragged far off makes the grid huge, past this many cells they are made bigger instead
+	const size_t MaxCells = 1 << 16;
+
+	// one bullet in a save, the arrays interleaved so a bullet keeps its offset while the count holds
+	struct SavedProjectile
+	{
+		float	x, y, vx, vy;
+		int32_t	lifespan;
+	};
+}
+
+ProjectilePool::ProjectilePool(size_t capacity)
+	: m_capacity(capacity)
+	, m_x(capacity)
+	, m_y(capacity)
+	, m_vx(capacity)
+	, m_vy(capacity)
+	, m_lifespan(capacity)
+{
+
+}
+
+void ProjectilePool::setShape(const Vec2& size, float cellSize)
+{
+	m_halfSize = Vec2(size.x / 2, size.y / 2);
+	m_cellSize = cellSize;
+}
+
+bool ProjectilePool::spawn(const Vec2& pos, const Vec2& velocity, int32_t lifespan)
+{
+	if (m_count == m_capacity) { return false; }
+
+	size_t i = m_count++;
+	m_x[i]			= pos.x;
+	m_y[i]			= pos.y;
+	m_vx[i]			= velocity.x;
+	m_vy[i]			= velocity.y;
+	m_lifespan[i]	= lifespan;
+	return true;
+}
+
+void ProjectilePool::buildGrid(const EntityVec& tiles, float left, float right)
+{
+	PROFILE_FUNCTION();
+
+	m_tiles.clear();
+	float top = std::numeric_limits<float>::max();
+	float bottom = std::numeric_limits<float>::lowest();
+	float gridRight = std::numeric_limits<float>::lowest();
+	m_gridLeft = std::numeric_limits<float>::max();
+
+	// only the tiles reaching into the strip the bullets cover, in tile order
+	for (Entity tile : tiles)
+	{
+		if (!tile.hasComponent<CBoundingBox>()) { continue; }
+
+		const Vec2& pos = tile.getComponent<CTransform>().pos;
+		const Vec2& half = tile.getComponent<CBoundingBox>().halfSize;
+		if (pos.x + half.x < left || pos.x - half.x > right) { continue; }
+
+		m_tiles.push_back({ pos.x, pos.y, half.x, half.y, tile });
+		m_gridLeft	= std::min(m_gridLeft, pos.x - half.x);
+		gridRight	= std::max(gridRight, pos.x + half.x);
+		top			= std::min(top, pos.y - half.y);
+		bottom		= std::max(bottom, pos.y + half.y);
+	}
+
+	m_columns = 0;
+	m_rows = 0;
+	if (m_tiles.empty()) { return; }
+
+	m_gridTop = top;
+	float cellSize = m_cellSize;
+	for (;;)
+	{
+		m_columns	= (int)((gridRight - m_gridLeft) / cellSize) + 1;
+		m_rows		= (int)((bottom - m_gridTop) / cellSize) + 1;
+		if ((size_t)m_columns * m_rows <= MaxCells) { break; }
+		cellSize *= 2;
+	}
+	m_gridCellSize = cellSize;
+
+	// a counting sort of the tiles into their cells, a tile goes in every cell its box touches
+	// so two boxes that touch always share a cell
+	size_t cellCount = (size_t)m_columns * m_rows;
+	m_cellStart.assign(cellCount + 1, 0);
+	for (const TileBox& box : m_tiles)
+	{
+		int x0, y0, x1, y1;
+		cells(box.x, box.y, box.halfWidth, box.halfHeight, x0, y0, x1, y1);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++) { m_cellStart[y * m_columns + x + 1]++; }
+		}
+	}
+	for (size_t c = 0; c < cellCount; c++) { m_cellStart[c + 1] += m_cellStart[c]; }
+
+	m_cellTiles.resize(m_cellStart[cellCount]);
+	m_candidates.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+	for (uint32_t t = 0; t < m_tiles.size(); t++)
+	{
+		const TileBox& box = m_tiles[t];
+		int x0, y0, x1, y1;
+		cells(box.x, box.y, box.halfWidth, box.halfHeight, x0, y0, x1, y1);
+		for (int y = y0; y <= y1; y++)
+		{
+			for (int x = x0; x <= x1; x++) { m_cellTiles[m_candidates[y * m_columns + x]++] = t; }
+		}
+	}
+}
+
+bool ProjectilePool::cells(float x, float y, float halfWidth, float halfHeight, int& x0, int& y0, int& x1, int& y1) const
+{
+	x0 = (int)std::floor((x - halfWidth - m_gridLeft) / m_gridCellSize);
+	x1 = (int)std::floor((x + halfWidth - m_gridLeft) / m_gridCellSize);
+	y0 = (int)std::floor((y - halfHeight - m_gridTop) / m_gridCellSize);
+	y1 = (int)std::floor((y + halfHeight - m_gridTop) / m_gridCellSize);
+	if (x1 < 0 || y1 < 0 || x0 >= m_columns || y0 >= m_rows) { return false; }
+
+	x0 = std::max(x0, 0);
+	y0 = std::max(y0, 0);
+	x1 = std::min(x1, m_columns - 1);
+	y1 = std::min(y1, m_rows - 1);
+	return true;
+}
+
+bool ProjectilePool::collide(size_t i, const Tilemap& tilemap)
+{
+	// the map already knows which of its cells are near
+	tilemap.query(Vec2(m_x[i], m_y[i]), m_halfSize, m_mapTiles);
+	m_mapHits.insert(m_mapHits.end(), m_mapTiles.begin(), m_mapTiles.end());
+	bool hit = !m_mapTiles.empty();
+
+	int x0, y0, x1, y1;
+	if (!cells(m_x[i], m_y[i], m_halfSize.x, m_halfSize.y, x0, y0, x1, y1)) { return hit; }
+
+	// a tile in more than one of the cells is only tested once
+	m_candidates.clear();
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			size_t cell = y * m_columns + x;
+			m_candidates.insert(m_candidates.end(), m_cellTiles.begin() + m_cellStart[cell], m_cellTiles.begin() + m_cellStart[cell + 1]);
+		}
+	}
+	if (m_candidates.empty()) { return hit; }
+	std::sort(m_candidates.begin(), m_candidates.end());
+	m_candidates.erase(std::unique(m_candidates.begin(), m_candidates.end()), m_candidates.end());
+
+	// the same test as Physics::GetOverlap, touching counts
+	for (uint32_t t : m_candidates)
+	{
+		const TileBox& box = m_tiles[t];
+		if ((m_halfSize.x + box.halfWidth) - std::abs(m_x[i] - box.x) < 0) { continue; }
+		if ((m_halfSize.y + box.halfHeight) - std::abs(m_y[i] - box.y) < 0) { continue; }
+
+		m_hits.push_back(box.tile);
+		hit = true;
+	}
+	return hit;
+}
+
+void ProjectilePool::compact()
+{
+	// keeps the bullets in the order they were fired
+	size_t alive = 0;
+	for (size_t i = 0; i < m_count; i++)
+	{
+		if (m_lifespan[i] < 0) { continue; }
+
+		m_x[alive]			= m_x[i];
+		m_y[alive]			= m_y[i];
+		m_vx[alive]			= m_vx[i];
+		m_vy[alive]			= m_vy[i];
+		m_lifespan[alive]	= m_lifespan[i];
+		alive++;
+	}
+	m_count = alive;
+}
+
+const std::vector<Entity>& ProjectilePool::update(const EntityVec& tiles, const Tilemap& tilemap)
+{
+	PROFILE_FUNCTION();
+
+	m_hits.clear();
+	m_mapHits.clear();
+	if (m_count == 0) { return m_hits; }
+
+	size_t count = m_count;
+	float* x = m_x.data();
+	float* y = m_y.data();
+	const float* vx = m_vx.data();
+	const float* vy = m_vy.data();
+	int32_t* lifespan = m_lifespan.data();
+
+	// straight loops over plain arrays, the compiler turns these into SIMD
+	for (size_t i = 0; i < count; i++) { lifespan[i]--; }
+	for (size_t i = 0; i < count; i++) { x[i] += vx[i]; }
+	for (size_t i = 0; i < count; i++) { y[i] += vy[i]; }
+
+	float left = std::numeric_limits<float>::max();
+	float right = std::numeric_limits<float>::lowest();
+	for (size_t i = 0; i < count; i++)
+	{
+		left = std::min(left, x[i]);
+		right = std::max(right, x[i]);
+	}
+	buildGrid(tiles, left - m_halfSize.x, right + m_halfSize.x);
+
+	if (!m_tiles.empty() || tilemap.count(LevelFile::Tile) > 0)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			if (lifespan[i] >= 0 && collide(i, tilemap)) { lifespan[i] = -1; }
+		}
+	}
+
+	compact();
+	return m_hits;
+}
+
+const std::vector<Tilemap::Tile>& ProjectilePool::mapHits() const
+{
+	return m_mapHits;
+}
+
+void ProjectilePool::clear()
+{
+	m_count = 0;
+}
+
+size_t ProjectilePool::count() const
+{
+	return m_count;
+}
+
+size_t ProjectilePool::capacity() const
+{
+	return m_capacity;
+}
+
+const Vec2& ProjectilePool::halfSize() const
+{
+	return m_halfSize;
+}
+
+Vec2 ProjectilePool::position(size_t i) const
+{
+	return Vec2(m_x[i], m_y[i]);
+}
+
+Vec2 ProjectilePool::velocity(size_t i) const
+{
+	return Vec2(m_vx[i], m_vy[i]);
+}
+
+void ProjectilePool::save(std::vector<uint8_t>& data) const
+{
+	data.resize(m_count * sizeof(SavedProjectile));
+	for (size_t i = 0; i < m_count; i++)
+	{
+		SavedProjectile saved = { m_x[i], m_y[i], m_vx[i], m_vy[i], m_lifespan[i] };
+		std::memcpy(data.data() + i * sizeof(SavedProjectile), &saved, sizeof(saved));
+	}
+}
+
+void ProjectilePool::load(const std::vector<uint8_t>& data)
+{
+	m_count = std::min(data.size() / sizeof(SavedProjectile), m_capacity);
+	for (size_t i = 0; i < m_count; i++)
+	{
+		SavedProjectile saved;
+		std::memcpy(&saved, data.data() + i * sizeof(SavedProjectile), sizeof(saved));
+		m_x[i]			= saved.x;
+		m_y[i]			= saved.y;
+		m_vx[i]			= saved.vx;
+		m_vy[i]			= saved.vy;
+		m_lifespan[i]	= saved.lifespan;
+	}
+}
+
+uint64_t ProjectilePool::checksum(uint64_t hash) const
+{
+	auto mix = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++) { hash = (hash ^ bytes[i]) * 1099511628211ull; }
+	};
+
+	// with nothing in flight the hash is the entities' alone
+	if (m_count == 0) { return hash; }
+
+	mix(&m_count, sizeof(m_count));
+	for (size_t i = 0; i < m_count; i++)
+	{
+		float values[] = { m_x[i], m_y[i], m_vx[i], m_vy[i] };
+		mix(values, sizeof(values));
+	}
+	return hash;
+}
+
+void ProjectilePool::draw(GameEngine* game, const sf::Texture* texture, const sf::View& view)
+{
+	if (m_count == 0) { return; }
+
+	float left		= view.getCenter().x - view.getSize().x / 2;
+	float right		= view.getCenter().x + view.getSize().x / 2;
+	float top		= view.getCenter().y - view.getSize().y / 2;
+	float bottom	= view.getCenter().y + view.getSize().y / 2;
+
+	float hw = m_halfSize.x;
+	float hh = m_halfSize.y;
+	m_vertices.clear();
+	for (size_t i = 0; i < m_count; i++)
+	{
+		if (m_x[i] + hw < left || m_x[i] - hw > right || m_y[i] + hh < top || m_y[i] - hh > bottom) { continue; }
+
+		// a bullet fired to the left is drawn mirrored, like the player it came from
+		float u0 = m_vx[i] < 0 ? 2 * hw : 0;
+		float u1 = 2 * hw - u0;
+
+		m_vertices.emplace_back(sf::Vector2f(m_x[i] - hw, m_y[i] - hh), sf::Vector2f(u0, 0));
+		m_vertices.emplace_back(sf::Vector2f(m_x[i] + hw, m_y[i] - hh), sf::Vector2f(u1, 0));
+		m_vertices.emplace_back(sf::Vector2f(m_x[i] + hw, m_y[i] + hh), sf::Vector2f(u1, 2 * hh));
+		m_vertices.emplace_back(sf::Vector2f(m_x[i] - hw, m_y[i] + hh), sf::Vector2f(u0, 2 * hh));
+	}
+	if (m_vertices.empty()) { return; }
+
+	sf::RenderStates states;
+	states.texture = texture;
+	game->draw(m_vertices.data(), m_vertices.size(), sf::Quads, states);
+}
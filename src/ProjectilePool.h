@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Common.h"
+#include "EntityManager.h"
+#include "Tilemap.h"
+
+#include <vector>
+#include <cstdint>
+
+class GameEngine;
+
+// the player's bullets, kept out of the ECS so firing never touches the entity pool
+//
+// every bullet has the same size and texture, so one is just a position, a velocity and the ticks it
+// has left, stored as structure of arrays of a fixed capacity. update() is the whole of their
+// simulation: it counts the lifespans down, moves them and tests them against the tiles
+//
+// the tile entities go into a uniform grid first, each bullet only looks at the cells its box covers
+// instead of at every tile, so the cost follows the bullets and not bullets times tiles. The tiles of
+// the Tilemap are a grid already and are looked up directly
+class ProjectilePool
+{
+public:
+
+	static const size_t DefaultCapacity	= 4096;
+
+private:
+
+	size_t					m_capacity;
+	size_t					m_count			= 0;
+	Vec2					m_halfSize		= { 1, 1 };
+	std::vector<float>		m_x, m_y, m_vx, m_vy;
+	std::vector<int32_t>	m_lifespan;					// ticks left, gone once it drops below zero
+
+	// the broadphase, rebuilt every update from the tiles near the bullets
+	struct TileBox
+	{
+		float	x, y;			// the tile's position and half size, as Physics::GetOverlap sees them
+		float	halfWidth, halfHeight;
+		Entity	tile;
+	};
+	float					m_cellSize		= 64;
+	float					m_gridCellSize	= 64;		// m_cellSize, or larger if the tiles are spread far apart
+	float					m_gridLeft		= 0;
+	float					m_gridTop		= 0;
+	int						m_columns		= 0;
+	int						m_rows			= 0;
+	std::vector<TileBox>	m_tiles;
+	std::vector<uint32_t>	m_cellStart;				// m_cellTiles[m_cellStart[c] .. m_cellStart[c + 1]] are in cell c
+	std::vector<uint32_t>	m_cellTiles;
+	std::vector<uint32_t>	m_candidates;
+	std::vector<Entity>		m_hits;
+	std::vector<Tilemap::Tile>	m_mapHits;
+	std::vector<Tilemap::Tile>	m_mapTiles;				// the map tiles one bullet touches
+	std::vector<sf::Vertex>	m_vertices;					// rebuilt by every draw
+
+	void buildGrid(const EntityVec& tiles, float left, float right);
+	bool cells(float x, float y, float halfWidth, float halfHeight, int& x0, int& y0, int& x1, int& y1) const;
+	bool collide(size_t i, const Tilemap& tilemap);
+	void compact();
+
+public:
+
+	ProjectilePool(size_t capacity = DefaultCapacity);
+
+	// the size of every bullet, the tile grid's cell size
+	void setShape(const Vec2& size, float cellSize);
+
+	// false if the pool is full
+	bool spawn(const Vec2& pos, const Vec2& velocity, int32_t lifespan);
+
+	// one tick of every bullet, gives back the tiles that were hit, a tile once for each bullet that hit it
+	// a bullet hits every tile it touches on the tick it first touches any and is gone after
+	// the tiles of the map that were hit are in mapHits() until the next update
+	const std::vector<Entity>& update(const EntityVec& tiles, const Tilemap& tilemap);
+	const std::vector<Tilemap::Tile>& mapHits() const;
+
+	void clear();
+	size_t count() const;
+	size_t capacity() const;
+	const Vec2& halfSize() const;
+	Vec2 position(size_t i) const;
+	Vec2 velocity(size_t i) const;
+
+	// the bullets as bytes in a layout that stays put from tick to tick, for save states and rewind
+	void save(std::vector<uint8_t>& data) const;
+	void load(const std::vector<uint8_t>& data);
+
+	// folds every bullet into an FNV-1a hash, see Scene::checksum
+	uint64_t checksum(uint64_t hash) const;
+
+	// every bullet in view as one batch of quads, flipped to the way it flies
+	void draw(GameEngine* game, const sf::Texture* texture, const sf::View& view);
+};
@@ -0,0 +1,280 @@
+#include "Replay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+namespace
+{
+	const char		Magic[4]	= { 'S', 'F', 'R', 'P' };
+	const uint32_t	Version		= 1;
+
+	static_assert(sizeof(Replay::ReplayHeader) == 16, "recording layout must not depend on the compiler");
+
+	uint64_t zigzag(long long value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	long long unzigzag(uint64_t value)
+	{
+		return (long long)(value >> 1) ^ -(long long)(value & 1);
+	}
+
+	bool readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; pos < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *pos++;
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) { return true; }
+		}
+		return false;
+	}
+
+	bool readChecksum(const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+	{
+		if (end - pos < 8) { return false; }
+		std::memcpy(&value, pos, 8);
+		pos += 8;
+		return true;
+	}
+}
+
+Replay::~Replay()
+{
+	// a recording that was never finished still keeps everything up to the last flush
+	flush();
+}
+
+bool Replay::record(const std::string& path)
+{
+	m_stream = std::ofstream(path, std::ios::binary);
+	if (!m_stream)
+	{
+		std::cerr << "Could not write recording: " << path << std::endl;
+		return false;
+	}
+
+	ReplayHeader header = {};
+	std::memcpy(header.magic, Magic, 4);
+	header.version = Version;
+	m_stream.write((const char*)&header, sizeof(header));
+
+	m_buffer.reserve(4096);
+	m_mode = Recording;
+	return true;
+}
+
+bool Replay::play(const std::string& path)
+{
+	std::ifstream in(path, std::ios::binary);
+	ReplayHeader header = {};
+	if (!in.read((char*)&header, sizeof(header)) || !std::equal(Magic, Magic + 4, header.magic) || header.version != Version)
+	{
+		std::cerr << "Not a valid recording: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	const uint8_t* pos = data.data();
+	const uint8_t* end = pos + data.size();
+
+	size_t tick = 0;
+	bool ended = false;
+	while (pos < end && !ended)
+	{
+		uint8_t kind = *pos++;
+		uint64_t delta;
+		if (!readVarint(pos, end, delta)) { break; }
+		tick += delta;
+
+		if (kind == ActionEvent)
+		{
+			uint64_t name, type, x, y;
+			if (!readVarint(pos, end, name) || !readVarint(pos, end, type) ||
+				!readVarint(pos, end, x) || !readVarint(pos, end, y)) { break; }
+			if (name >= (uint64_t)ActionName::COUNT || type > (uint64_t)ActionType::END) { break; }
+
+			Vec2 actionPos((float)unzigzag(x), (float)unzigzag(y));
+			m_actions.push_back({ tick, Action((ActionName)name, (ActionType)type, actionPos) });
+		}
+		else if (kind == Checksum || kind == End)
+		{
+			uint64_t checksum;
+			if (!readChecksum(pos, end, checksum)) { break; }
+
+			m_checksums.push_back({ tick, checksum });
+			ended = kind == End;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	// a recording cut short by a crash plays up to the last event that made it to disk
+	if (!ended)
+	{
+		std::cerr << "Recording has no end, replaying what was saved\n";
+		m_endTick = m_actions.empty() ? 0 : m_actions.back().tick + 1;
+		if (!m_checksums.empty()) { m_endTick = std::max(m_endTick, m_checksums.back().tick + 1); }
+	}
+	else
+	{
+		m_endTick = tick;
+	}
+
+	m_tickTimes.reserve(m_endTick);
+	m_mode = Playing;
+	std::cout << "Replaying " << m_actions.size() << " actions over " << m_endTick << " ticks from " << path << std::endl;
+	return true;
+}
+
+bool Replay::recording() const
+{
+	return m_mode == Recording;
+}
+
+bool Replay::playing() const
+{
+	return m_mode == Playing;
+}
+
+bool Replay::finished(size_t tick) const
+{
+	return m_mode == Playing && tick >= m_endTick;
+}
+
+void Replay::writeVarint(uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		m_buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	m_buffer.push_back((uint8_t)value);
+}
+
+void Replay::writeEvent(Kind kind, size_t tick)
+{
+	m_buffer.push_back(kind);
+	writeVarint(tick - m_lastTick);
+	m_lastTick = tick;
+}
+
+void Replay::writeChecksum(uint64_t checksum)
+{
+	const uint8_t* bytes = (const uint8_t*)&checksum;
+	m_buffer.insert(m_buffer.end(), bytes, bytes + 8);
+}
+
+void Replay::flush()
+{
+	if (m_buffer.empty() || !m_stream) { return; }
+
+	m_stream.write((const char*)m_buffer.data(), m_buffer.size());
+	m_stream.flush();
+	m_buffer.clear();
+}
+
+void Replay::action(size_t tick, const Action& action)
+{
+	if (m_mode != Recording) { return; }
+
+	writeEvent(ActionEvent, tick);
+	writeVarint((uint64_t)action.name());
+	writeVarint((uint64_t)action.type());
+	writeVarint(zigzag((long long)action.pos().x));
+	writeVarint(zigzag((long long)action.pos().y));
+}
+
+bool Replay::wantsChecksum(size_t tick) const
+{
+	if (m_mode == Recording)	{ return tick % ChecksumInterval == ChecksumInterval - 1; }
+	if (m_mode == Playing)		{ return m_nextChecksum < m_checksums.size() && m_checksums[m_nextChecksum].tick == tick; }
+	return false;
+}
+
+void Replay::compare(size_t tick, uint64_t checksum)
+{
+	if (m_nextChecksum >= m_checksums.size() || m_checksums[m_nextChecksum].tick != tick) { return; }
+
+	if (m_checksums[m_nextChecksum].checksum == checksum)	{ m_matched++; }
+	else if (m_firstDivergence == (size_t)-1)				{ m_firstDivergence = tick; }
+	m_nextChecksum++;
+}
+
+void Replay::endTick(size_t tick, long long duration, uint64_t checksum)
+{
+	if (m_mode == Recording && wantsChecksum(tick))
+	{
+		writeEvent(Checksum, tick);
+		writeChecksum(checksum);
+
+		// a crash loses at most one interval of input
+		flush();
+	}
+	else if (m_mode == Playing)
+	{
+		m_tickTimes.push_back(duration / 1000000.0f);
+		compare(tick, checksum);
+	}
+}
+
+void Replay::finish(size_t tick, uint64_t checksum)
+{
+	if (m_mode == Recording)
+	{
+		writeEvent(End, tick);
+		writeChecksum(checksum);
+		flush();
+		std::cout << "Recorded " << tick << " ticks" << std::endl;
+	}
+	else if (m_mode == Playing)
+	{
+		// the End checksum is stored against the tick count, after the last tick ran
+		compare(tick, checksum);
+		report();
+	}
+
+	m_mode = Off;
+}
+
+void Replay::report()
+{
+	if (m_tickTimes.empty()) { return; }
+
+	std::vector<float> sorted = m_tickTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0;
+	for (float time : m_tickTimes) { total += time; }
+	size_t slowest = std::max_element(m_tickTimes.begin(), m_tickTimes.end()) - m_tickTimes.begin();
+
+	std::printf("Replay: %zu of %zu ticks in %.2fs\n", m_tickTimes.size(), m_endTick, total / 1000.0);
+	std::printf("  tick ms  mean %.3f  p50 %.3f  p99 %.3f  max %.3f (tick %zu)\n",
+		total / m_tickTimes.size(), sorted[sorted.size() / 2], sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)],
+		sorted.back(), slowest);
+
+	if (m_firstDivergence != (size_t)-1)
+	{
+		std::printf("  checksums: %zu of %zu matched, DIVERGED at tick %zu\n", m_matched, m_checksums.size(), m_firstDivergence);
+	}
+	else
+	{
+		std::printf("  checksums: %zu of %zu matched\n", m_matched, m_checksums.size());
+	}
+
+	// every tick for plotting or diffing two runs
+	FILE* csv = std::fopen("replay.csv", "w");
+	if (csv)
+	{
+		std::fprintf(csv, "tick,milliseconds\n");
+		for (size_t i = 0; i < m_tickTimes.size(); i++) { std::fprintf(csv, "%zu,%.4f\n", i, m_tickTimes[i]); }
+		std::fclose(csv);
+		std::printf("  per tick timings written to replay.csv\n");
+	}
+	std::fflush(stdout);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Common.h"
+#include "Action.h"
+
+#include <fstream>
+#include <cstdint>
+
+// Records the actions the engine hands to its scenes, tick by tick, and plays them back
+//
+// Recording layout (.rec), little endian:
+//   ReplayHeader
+//   a run of events, each a Kind byte then unsigned LEB128 varints, the tick is a delta to the previous event:
+//     Action   tick delta, name, type, zigzag x, zigzag y
+//     Checksum tick delta, then the 8 byte state checksum after that tick
+//     End      tick delta to the tick count the recording stopped at, then the 8 byte final checksum
+//
+// the simulation only advances once per tick and never looks at the clock, so feeding the same actions
+// at the same ticks rebuilds the same game. The checksums written while recording let a replay prove it did
+class Replay
+{
+public:
+
+	enum Kind : uint8_t { ActionEvent = 1, Checksum = 2, End = 3 };
+
+	struct ReplayHeader
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint64_t	reserved;
+	};
+
+	struct TickAction
+	{
+		size_t		tick = 0;
+		Action		action;
+	};
+
+	struct TickChecksum
+	{
+		size_t		tick = 0;
+		uint64_t	checksum = 0;
+	};
+
+	static const size_t ChecksumInterval = 60;		// ticks between checksums while recording
+
+private:
+
+	enum Mode { Off, Recording, Playing };
+
+	Mode					m_mode = Off;
+
+	// recording
+	std::ofstream			m_stream;
+	std::vector<uint8_t>	m_buffer;
+	size_t					m_lastTick = 0;
+
+	// playing
+	std::vector<TickAction>		m_actions;
+	std::vector<TickChecksum>	m_checksums;		// the End checksum is the last one
+	size_t						m_nextAction = 0;
+	size_t						m_nextChecksum = 0;
+	size_t						m_endTick = 0;
+	std::vector<float>			m_tickTimes;		// milliseconds, indexed by tick
+	size_t						m_matched = 0;
+	size_t						m_firstDivergence = (size_t)-1;
+
+	void writeVarint(uint64_t value);
+	void writeEvent(Kind kind, size_t tick);
+	void writeChecksum(uint64_t checksum);
+	void flush();
+	void compare(size_t tick, uint64_t checksum);
+	void report();
+
+public:
+
+	~Replay();
+
+	bool record(const std::string& path);
+	bool play(const std::string& path);
+
+	bool recording() const;
+	bool playing() const;
+
+	// true once a replay has fed its last tick
+	bool finished(size_t tick) const;
+
+	// while recording, every action the engine dispatches in a tick
+	void action(size_t tick, const Action& action);
+
+	// while playing, calls dispatch for every action recorded on this tick
+	template <typename F>
+	void feed(size_t tick, F dispatch)
+	{
+		for (; m_nextAction < m_actions.size() && m_actions[m_nextAction].tick <= tick; m_nextAction++)
+		{
+			dispatch(m_actions[m_nextAction].action);
+		}
+	}
+
+	// the checksum is only computed on the ticks that need one
+	bool wantsChecksum(size_t tick) const;
+	void endTick(size_t tick, long long duration, uint64_t checksum);
+
+	// writes the end of a recording, or prints the report of a replay
+	// tick is the number of ticks run and checksum the state they left behind
+	void finish(size_t tick, uint64_t checksum);
+};
@@ -0,0 +1,298 @@
+#include "RewindBuffer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// a changed run only ends at this many unchanged bytes in a row, shorter gaps are cheaper sent as they are
+	const size_t MinUnchangedRun = 4;
+
+	void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back((uint8_t)(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back((uint8_t)value);
+	}
+
+	bool readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; pos < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *pos++;
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) { return true; }
+		}
+		return false;
+	}
+
+	// bytes from pos on that are the same in data and base, base is zero past its end
+	size_t unchangedRun(const uint8_t* data, size_t size, const uint8_t* base, size_t baseSize, size_t pos)
+	{
+		size_t start = pos;
+		size_t both = std::min(size, baseSize);
+
+		// most of a frame is the same as its keyframe, skip it a block at a time and then find the first
+		// changed byte a word at a time
+		while (pos + 64 <= both && std::memcmp(data + pos, base + pos, 64) == 0) { pos += 64; }
+		while (pos + 8 <= both)
+		{
+			uint64_t a, b;
+			std::memcpy(&a, data + pos, 8);
+			std::memcpy(&b, base + pos, 8);
+			if (a != b) { break; }
+			pos += 8;
+		}
+		while (pos < both && data[pos] == base[pos]) { pos++; }
+		if (pos >= both)
+		{
+			while (pos < size && data[pos] == 0) { pos++; }
+		}
+		return pos - start;
+	}
+}
+
+void RewindBuffer::Configure(size_t ticks)
+{
+	s_ticks = ticks;
+}
+
+RewindBuffer::RewindBuffer()
+	: RewindBuffer(s_ticks, DefaultKeyframeInterval)
+{
+
+}
+
+// a tick can only be restored while its keyframe is still in the ring, so the history that can be stepped
+// back through is anywhere from ticks - interval to ticks long. An interval as long as the ring would leave
+// nothing right after every keyframe is overwritten, capped at half of it at least half the ring is usable
+RewindBuffer::RewindBuffer(size_t ticks, size_t keyframeInterval)
+	: m_entries(ticks)
+	, m_keyframeInterval(std::max<size_t>(std::min(keyframeInterval, ticks / 2), 1))
+{
+
+}
+
+RewindBuffer::Entry& RewindBuffer::entry(size_t index)
+{
+	return m_entries[(m_first + index) % m_entries.size()];
+}
+
+const RewindBuffer::Entry* RewindBuffer::find(size_t tick) const
+{
+	if (m_count == 0 || tick < m_entries[m_first].tick || tick - m_entries[m_first].tick >= m_count) { return nullptr; }
+
+	const Entry& found = m_entries[(m_first + tick - m_entries[m_first].tick) % m_entries.size()];
+
+	// the keyframe is older than the ticks coded against it, so it is the first to be overwritten
+	if (found.keyTick < m_entries[m_first].tick) { return nullptr; }
+	return &found;
+}
+
+void RewindBuffer::Encode(const Frame& frame, const Frame* key, std::vector<uint8_t>& out)
+{
+	out.clear();
+	for (size_t s = 0; s < frame.size(); s++)
+	{
+		const uint8_t* data = frame[s].data();
+		size_t size = frame[s].size();
+		const uint8_t* base = key ? (*key)[s].data() : nullptr;
+		size_t baseSize = key ? (*key)[s].size() : 0;
+
+		writeVarint(out, size);
+
+		size_t pos = 0;
+		while (pos < size)
+		{
+			size_t unchanged = unchangedRun(data, size, base, baseSize, pos);
+			size_t start = pos + unchanged;
+
+			size_t end = start;
+			while (end < size)
+			{
+				// inside a changed run most bytes differ, only look for a long enough gap when one does not
+				if (data[end] != (end < baseSize ? base[end] : 0)) { end++; continue; }
+
+				size_t gap = unchangedRun(data, size, base, baseSize, end);
+				if (gap >= MinUnchangedRun || end + gap >= size) { break; }
+				end += gap;
+			}
+
+			writeVarint(out, unchanged);
+			writeVarint(out, end - start);
+
+			size_t at = out.size();
+			out.insert(out.end(), data + start, data + end);
+			for (size_t i = start; i < std::min(end, baseSize); i++) { out[at + i - start] ^= base[i]; }
+			pos = end;
+		}
+	}
+}
+
+bool RewindBuffer::Decode(const std::vector<uint8_t>& data, const Frame* key, Frame& frame)
+{
+	const uint8_t* pos = data.data();
+	const uint8_t* end = pos + data.size();
+
+	size_t sections = 0;
+	while (pos < end)
+	{
+		uint64_t size;
+		if (!readVarint(pos, end, size)) { return false; }
+
+		if (frame.size() <= sections) { frame.emplace_back(); }
+		std::vector<uint8_t>& out = frame[sections];
+		out.resize(size);
+
+		const uint8_t* base = key && sections < key->size() ? (*key)[sections].data() : nullptr;
+		size_t baseSize = key && sections < key->size() ? (*key)[sections].size() : 0;
+
+		// start from the keyframe, then flip the bytes that changed
+		size_t copied = std::min<size_t>(size, baseSize);
+		if (copied > 0) { std::memcpy(out.data(), base, copied); }
+		std::fill(out.begin() + copied, out.end(), 0);
+
+		size_t at = 0;
+		while (at < size)
+		{
+			uint64_t unchanged, changed;
+			if (!readVarint(pos, end, unchanged) || !readVarint(pos, end, changed)) { return false; }
+			at += unchanged;
+			if (at + changed > size || (uint64_t)(end - pos) < changed) { return false; }
+
+			for (uint64_t i = 0; i < changed; i++) { out[at + i] ^= *pos++; }
+			at += changed;
+		}
+		sections++;
+	}
+
+	frame.resize(sections);
+	return true;
+}
+
+void RewindBuffer::push(size_t tick, const Frame& frame)
+{
+	if (!enabled()) { return; }
+
+	PROFILE_FUNCTION();
+
+	if (m_count > 0 && tick != newestTick() + 1) { clear(); }
+
+	// the frame changed shape (a section came or went), nothing lines up with the keyframe any more
+	bool keyframe = m_keyTick == (size_t)-1 || tick - m_keyTick >= m_keyframeInterval || m_key.size() != frame.size();
+
+	Entry* slot;
+	if (m_count < m_entries.size())
+	{
+		slot = &entry(m_count);
+		m_count++;
+	}
+	else
+	{
+		slot = &entry(0);
+		m_first = (m_first + 1) % m_entries.size();
+	}
+
+	slot->tick = tick;
+	size_t room = slot->data.capacity();
+	if (keyframe)
+	{
+		Encode(frame, nullptr, slot->data);
+
+		// copied section by section into the key's own buffers, which only grow with the sections
+		m_key.resize(frame.size());
+		for (size_t s = 0; s < frame.size(); s++)
+		{
+			AllocationTracker::Reserve(m_key[s], frame[s].size());
+			m_key[s].assign(frame[s].begin(), frame[s].end());
+		}
+		m_keyTick = tick;
+	}
+	else
+	{
+		Encode(frame, &m_key, slot->data);
+	}
+	slot->keyTick = m_keyTick;
+
+	// an entry keeps its buffer when the ring wraps, one that had to grow gets room to double so the ticks
+	// coded into it later on are not reallocated every time the level around them grows a little
+	if (slot->data.capacity() > room)
+	{
+		slot->data.reserve(slot->data.size() * 2);
+		AllocationTracker::Growing();
+	}
+}
+
+bool RewindBuffer::restore(size_t tick, Frame& frame)
+{
+	PROFILE_FUNCTION();
+
+	const Entry* found = find(tick);
+	if (!found) { return false; }
+
+	if (found->keyTick != m_keyTick)
+	{
+		if (!Decode(find(found->keyTick)->data, nullptr, m_key)) { return false; }
+		m_keyTick = found->keyTick;
+	}
+
+	if (found->keyTick == tick)	{ frame = m_key; }
+	else if (!Decode(found->data, &m_key, frame)) { return false; }
+
+	// the ticks after this one never happened now, the next push carries on from here
+	m_count = tick - m_entries[m_first].tick + 1;
+	return true;
+}
+
+void RewindBuffer::clear()
+{
+	m_first = 0;
+	m_count = 0;
+	m_keyTick = (size_t)-1;
+}
+
+bool RewindBuffer::enabled() const
+{
+	return !m_entries.empty();
+}
+
+bool RewindBuffer::contains(size_t tick) const
+{
+	return find(tick) != nullptr;
+}
+
+size_t RewindBuffer::oldestTick() const
+{
+	if (m_count == 0) { return 0; }
+
+	// the ticks before the oldest whole keyframe can no longer be decoded
+	size_t tick = m_entries[m_first].tick;
+	while (tick <= newestTick() && !find(tick)) { tick++; }
+	return tick;
+}
+
+size_t RewindBuffer::newestTick() const
+{
+	return m_count == 0 ? 0 : m_entries[m_first].tick + m_count - 1;
+}
+
+size_t RewindBuffer::tickCount() const
+{
+	return m_count == 0 ? 0 : newestTick() - oldestTick() + 1;
+}
+
+size_t RewindBuffer::bytes() const
+{
+	size_t total = 0;
+	for (size_t i = 0; i < m_count; i++)
+	{
+		total += m_entries[(m_first + i) % m_entries.size()].data.size();
+	}
+	for (auto& section : m_key) { total += section.size(); }
+	return total;
+}
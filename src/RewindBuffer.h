@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// a ring of the last few seconds of world state, one frame per tick, that can be stepped back through
+//
+// a frame is a list of sections that keep their meaning from tick to tick, section 3 is always the same
+// component array and a slot is always at the same offset in it. Every KeyframeInterval ticks the frame is
+// stored whole, the ticks in between are xor'd section by section against that keyframe and run length
+// coded, so everything that did not move since the keyframe costs almost nothing
+//
+// entry layout, for every section:
+//   varint section length, then runs of (varint unchanged bytes, varint changed bytes, changed bytes xor keyframe)
+// a keyframe is coded the same way against nothing, which squeezes out the empty slots and zeroed fields
+//
+// restoring a tick only ever decodes its keyframe and its own delta
+class RewindBuffer
+{
+public:
+
+	typedef std::vector<std::vector<uint8_t>> Frame;
+
+	static const size_t DefaultTicks			= 300;		// five seconds at 60 Hz
+	static const size_t DefaultKeyframeInterval	= 60;
+
+private:
+
+	static inline size_t	s_ticks = DefaultTicks;
+
+	struct Entry
+	{
+		size_t					tick		= 0;
+		size_t					keyTick		= 0;		// the keyframe this entry is coded against, its own tick for a keyframe
+		std::vector<uint8_t>	data;
+	};
+
+	std::vector<Entry>		m_entries;				// ring, holds ticks m_entries[m_first].tick onwards
+	size_t					m_first				= 0;
+	size_t					m_count				= 0;
+	size_t					m_keyframeInterval;
+
+	// the decoded keyframe new ticks are coded against, and the one restore last decoded
+	Frame					m_key;
+	size_t					m_keyTick			= (size_t)-1;
+
+	Entry& entry(size_t index);
+	const Entry* find(size_t tick) const;
+
+	static void Encode(const Frame& frame, const Frame* key, std::vector<uint8_t>& out);
+	static bool Decode(const std::vector<uint8_t>& data, const Frame* key, Frame& frame);
+
+public:
+
+	// the history length of every buffer made with the default constructor from now on, 0 turns rewinding off
+	static void Configure(size_t ticks);
+
+	RewindBuffer();
+
+	// keyframeInterval is clamped to between 1 and ticks / 2
+	RewindBuffer(size_t ticks, size_t keyframeInterval);
+
+	// stores the world after tick ran, ticks have to come one after another or the history starts over
+	void push(size_t tick, const Frame& frame);
+
+	// decodes the world as it was after tick into frame and drops every tick after it
+	// false if tick is no longer, or never was, in the history
+	bool restore(size_t tick, Frame& frame);
+
+	void clear();
+
+	bool enabled() const;
+
+	bool contains(size_t tick) const;
+	size_t oldestTick() const;
+	size_t newestTick() const;
+	size_t tickCount() const;
+
+	// bytes held by the coded entries, the memory the history costs
+	size_t bytes() const;
+};
@@ -7,37 +7,122 @@ Scene::Scene(GameEngine* gameEngine)
 
 }
 
+Scene::~Scene()
+{
+	// the pool outlives every scene, give back the slots this one used
+	m_entityManager.clear();
+}
+
+void Scene::onEnter()
+{
+	// called on the main thread each time the engine makes this the active scene
+}
+
+void Scene::sInput(const InputState& input)
+{
+	// most ticks nothing happened
+	if (!input.any()) { return; }
+
+	PROFILE_FUNCTION();
+
+	// however often it moved, the mouse is only where it ended up
+	if (input.mouseMoved) { m_game->dispatch(Action(ActionName::MOUSE_MOVE, input.mouse)); }
+
+	for (int key = 0; key < sf::Keyboard::KeyCount; key++)
+	{
+		if (!input.pressed[key] && !input.released[key]) { continue; }
+
+		const ActionName name = getAction(key);
+		if (name == ActionName::NONE) { continue; }
+
+		// both edges in one tick, the one that leaves the key as it is now goes last
+		bool start = input.pressed[key], end = input.released[key];
+		if (start && end && input.down[key]) { m_game->dispatch(Action(name, ActionType::END)); end = false; }
+		if (start)	{ m_game->dispatch(Action(name, ActionType::START)); }
+		if (end)	{ m_game->dispatch(Action(name, ActionType::END)); }
+	}
+
+	// indexed by sf::Mouse::Button, the extra buttons have no action
+	static const ActionName Clicks[] = { ActionName::LEFT_CLICK, ActionName::RIGHT_CLICK, ActionName::MIDDLE_CLICK };
+	for (int button = sf::Mouse::Left; button <= sf::Mouse::Middle; button++)
+	{
+		bool start = input.buttonsPressed[button], end = input.buttonsReleased[button];
+		if (start && end && input.buttonsDown[button]) { m_game->dispatch(Action(Clicks[button], ActionType::END, input.buttonPos[button])); end = false; }
+		if (start)	{ m_game->dispatch(Action(Clicks[button], ActionType::START, input.buttonPos[button])); }
+		if (end)	{ m_game->dispatch(Action(Clicks[button], ActionType::END, input.buttonPos[button])); }
+	}
+}
+
 void Scene::setPaused(bool paused)
 {
 	m_paused = paused;
 }
 
-std::map<int, std::string>& Scene::getActionMap()
+ActionMap& Scene::getActionMap()
 {
 	return m_actionMap;
 }
 
+ActionName Scene::getAction(int key) const
+{
+	// sf::Keyboard::Unknown (-1) and any out of range codes are never bound
+	if (key < 0 || key >= (int)m_actionMap.size()) { return ActionName::NONE; }
+	return m_actionMap[key];
+}
+
 size_t Scene::width() const
 {
-	return m_game->window().getSize().x;
+	return m_game->windowSize().x;
 }
 
 size_t Scene::height() const
 {
-	return m_game->window().getSize().y;
+	return m_game->windowSize().y;
+}
+
+uint64_t Scene::checksum()
+{
+	PROFILE_FUNCTION();
+
+	// FNV-1a over the raw bytes, floats are compared bit for bit
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const void* data, size_t size)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		for (size_t i = 0; i < size; i++) { hash = (hash ^ bytes[i]) * 1099511628211ull; }
+	};
+
+	for (Entity e : m_entityManager.getEntities())
+	{
+		size_t id = e.id();
+		Tag tag = e.tag();
+		mix(&id, sizeof(id));
+		mix(&tag, sizeof(tag));
+
+		if (e.hasComponent<CTransform>())
+		{
+			const CTransform& transform = e.getComponent<CTransform>();
+			mix(&transform.pos, sizeof(transform.pos));
+			mix(&transform.velocity, sizeof(transform.velocity));
+		}
+	}
+
+	return hash;
 }
 
 void Scene::simulate(int i)
 {
 	update();
+
+	PROFILE_COUNTER("Entities", m_entityManager.getTotal());
 }
 
-void Scene::doAction(Action action)
+void Scene::doAction(const Action& action)
 {
 	sDoAction(action);
 }
 
-void Scene::registerAction(sf::Keyboard::Key key, const std::string& action)
+void Scene::registerAction(sf::Keyboard::Key key, ActionName action)
 {
 	m_actionMap[key] = action;
 }
\ No newline at end of file
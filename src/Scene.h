@@ -3,12 +3,15 @@
 #include "Common.h"
 #include "Action.h"
 #include "EntityManager.h"
+#include "InputState.h"
 
 #include <memory>
+#include <array>
 
 class GameEngine;
 
-typedef std::map<int, std::string> ActionMap;
+// indexed directly by sf::Keyboard::Key, unbound keys map to ActionName::NONE
+typedef std::array<ActionName, sf::Keyboard::KeyCount> ActionMap;
 
 class Scene
 {
@@ -17,7 +20,7 @@ protected:
 
     GameEngine*     m_game;
     EntityManager   m_entityManager;
-    ActionMap       m_actionMap;
+    ActionMap       m_actionMap = {};
     bool            m_paused = false;
     bool            m_hasEnded = false;
     size_t          m_currentFrame = 0;
@@ -28,17 +31,27 @@ protected:
 public:
 
     Scene(GameEngine* gameEngine);
+    virtual ~Scene();
 
     virtual void update() = 0;
-    virtual void sDoAction(Action action) = 0;
+    virtual void sDoAction(const Action& action) = 0;
     virtual void sRender() = 0;
+    virtual void onEnter();
+
+    // called once per tick before simulate, sends the edges of this tick's input
+    // through the action map to sDoAction
+    virtual void sInput(const InputState& input);
 
     void simulate(int i);
-    void doAction(Action action);
-    void registerAction(sf::Keyboard::Key key, const std::string& action);
+    void doAction(const Action& action);
+    void registerAction(sf::Keyboard::Key key, ActionName action);
 
     size_t width() const;
     size_t height() const;
 
+    // hash of every live entity's id, tag and motion, equal between two runs only if they simulated the same
+    virtual uint64_t checksum();
+
     ActionMap& getActionMap();
+    ActionName getAction(int key) const;
 };
\ No newline at end of file
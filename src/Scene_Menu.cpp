@@ -15,10 +15,10 @@ Scene_Menu::Scene_Menu(GameEngine* gameEngine)
 void Scene_Menu::init()
 {
 	PROFILE_FUNCTION();
-	registerAction(sf::Keyboard::W,		"UP");
-	registerAction(sf::Keyboard::S,		"DOWN");
-	registerAction(sf::Keyboard::D,		"PLAY");
-	registerAction(sf::Keyboard::Escape,"QUIT");
+	registerAction(sf::Keyboard::W,		ActionName::UP);
+	registerAction(sf::Keyboard::S,		ActionName::DOWN);
+	registerAction(sf::Keyboard::D,		ActionName::PLAY);
+	registerAction(sf::Keyboard::Escape,ActionName::QUIT);
 
 	m_title = "Mega Mario";
 	m_menuStrings.push_back("Level 1");
@@ -28,6 +28,13 @@ void Scene_Menu::init()
 	m_levelPaths.push_back("level1.txt");
 	m_levelPaths.push_back("level2.txt");
 	m_levelPaths.push_back("level3.txt");
+
+	// prefer a level converted with --convert-level when one sits next to the text file
+	for (auto& path : m_levelPaths)
+	{
+		std::string binaryPath = path.substr(0, path.find_last_of('.')) + ".lvl";
+		if (std::ifstream(binaryPath).good()) { path = binaryPath; }
+	}
  
 	m_menuText.setFont(m_game->assets().getFont("Megaman"));
 	m_menuText.setCharacterSize(64);
@@ -36,30 +43,57 @@ void Scene_Menu::init()
 void Scene_Menu::update()
 {
 	m_entityManager.update();
+
+	// build the highlighted level in the background so pressing play only swaps it in
+	if (m_preloadedIndex != m_selectedMenuIndex && m_game->assets().isLoaded())
+	{
+		GameEngine* game = m_game;
+		std::string path = m_levelPaths[m_selectedMenuIndex];
+		m_game->preloadScene(path, [game, path]() { return std::make_shared<Scene_Play>(game, path); });
+		m_preloadedIndex = m_selectedMenuIndex;
+	}
+}
+
+void Scene_Menu::onEnter()
+{
+	// the last preload was consumed by the level we are coming back from
+	m_preloadedIndex = -1;
 }
 
-void Scene_Menu::sDoAction(Action action)
+void Scene_Menu::sDoAction(const Action& action)
 {
+	if (action.type() != ActionType::START) { return; }
+
 	PROFILE_FUNCTION();
-	if (action.type() == "START")
+	switch (action.name())
 	{
-		if (action.name() == "UP")
+		case ActionName::UP:
 		{
 			if (m_selectedMenuIndex > 0) { m_selectedMenuIndex--; }
 			else { m_selectedMenuIndex = m_menuStrings.size() - 1; }
+			break;
 		}
-		else if (action.name() == "DOWN")
+		case ActionName::DOWN:
 		{
 			m_selectedMenuIndex = (m_selectedMenuIndex + 1) % m_menuStrings.size();
+			break;
 		}
-		else if (action.name() == "PLAY")
+		case ActionName::PLAY:
 		{
-			m_game->changeScene("PLAY", std::make_shared<Scene_Play>(m_game, m_levelPaths[m_selectedMenuIndex]));
+			// levels need every texture, finish off anything still streaming in
+			m_game->waitForAssets();
+			const std::string& path = m_levelPaths[m_selectedMenuIndex];
+			std::shared_ptr<Scene> scene = m_game->takePreloadedScene(path);
+			if (!scene) { scene = std::make_shared<Scene_Play>(m_game, path); }
+			m_game->changeScene("PLAY", scene);
+			break;
 		}
-		else if (action.name() == "QUIT")
+		case ActionName::QUIT:
 		{
 			onEnd();
+			break;
 		}
+		default: break;
 	}
 }
 
@@ -67,15 +101,15 @@ void Scene_Menu::sRender()
 {
 	PROFILE_FUNCTION();
 	// clear the window
-	m_game->window().setView(m_game->window().getDefaultView());
-	m_game->window().clear(sf::Color(100, 100, 255));
+	m_game->window().setView(m_game->defaultView());
+	m_game->clear(sf::Color(100, 100, 255));
 
 	// Title
 	m_menuText.setCharacterSize(48);
 	m_menuText.setString(m_title);
 	m_menuText.setFillColor(sf::Color::Black);
 	m_menuText.setPosition(sf::Vector2f(10, 10));
-	m_game->window().draw(m_menuText);
+	m_game->draw(m_menuText);
 
 	// Levels
 	for (size_t i = 0; i < m_menuStrings.size(); i++)
@@ -83,15 +117,23 @@ void Scene_Menu::sRender()
 		m_menuText.setString(m_menuStrings[i]);
 		m_menuText.setFillColor(i == m_selectedMenuIndex ? sf::Color::White : sf::Color::Black);
 		m_menuText.setPosition(sf::Vector2f(10, 110 + i * 72));
-		m_game->window().draw(m_menuText);
+		m_game->draw(m_menuText);
 	}
 
 	// hint
 	m_menuText.setCharacterSize(20);
 	m_menuText.setColor(sf::Color::Black);
-	m_menuText.setString("UP: W     DOWN: S     PLAY: D     BACK: ESC");
+	if (m_game->assets().isLoaded())
+	{
+		m_menuText.setString("UP: W     DOWN: S     PLAY: D     BACK: ESC");
+	}
+	else
+	{
+		const Assets& assets = m_game->assets();
+		m_menuText.setString("LOADING " + std::to_string(assets.pendingTotal() - assets.pendingCount()) + "/" + std::to_string(assets.pendingTotal()));
+	}
 	m_menuText.setPosition(sf::Vector2f(10, 690));
-	m_game->window().draw(m_menuText);
+	m_game->draw(m_menuText);
 }
 
 void Scene_Menu::onEnd()
@@ -16,6 +16,7 @@ protected:
 	std::vector<std::string>	m_menuStrings;
 	std::vector<std::string>	m_levelPaths;
 	int							m_selectedMenuIndex = 0;
+	int							m_preloadedIndex = -1;
 	sf::Text					m_menuText;
 
 	void init();
@@ -25,8 +26,9 @@ public:
 	Scene_Menu(GameEngine* gameEngine);
 
 	virtual void update() override;
-	virtual void sDoAction(Action action) override;
+	virtual void sDoAction(const Action& action) override;
 	virtual void sRender() override;
+	virtual void onEnter() override;
 	virtual void onEnd() override;
 
 };
\ No newline at end of file
@@ -6,6 +6,73 @@
 #include "Components.h"
 #include "Action.h"
 
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// the sections of a rewind frame, a section must mean the same thing on every tick
+	enum RewindSection
+	{
+		PoolCounters,
+		Components,
+		Tags = Components + EntityPoolSnapshot::ComponentCount,
+		Active,
+		Allocated,
+		PageAllocated,
+		Entities,
+		Pending,
+		Chunks,
+		Projectiles,
+		Tiles,
+		SectionCount
+	};
+
+	template <typename T>
+	void Store(std::vector<uint8_t>& section, const std::vector<T>& values)
+	{
+		AllocationTracker::Reserve(section, values.size() * sizeof(T));
+		section.resize(values.size() * sizeof(T));
+		if (!values.empty()) { std::memcpy(section.data(), values.data(), section.size()); }
+	}
+
+	template <typename T>
+	void Load(const std::vector<uint8_t>& section, std::vector<T>& values)
+	{
+		values.resize(section.size() / sizeof(T));
+		if (!values.empty()) { std::memcpy(values.data(), section.data(), values.size() * sizeof(T)); }
+	}
+
+	// the corners of a frame sized sprite with its origin in the middle, the way sf::Sprite places them
+	void PlaceQuad(sf::Vertex* quad, const CTransform& transform, const Vec2& size)
+	{
+		float radians = transform.angle * 3.14159265f / 180.0f;
+		float c = std::cos(radians);
+		float s = std::sin(radians);
+		float hw = size.x / 2;
+		float hh = size.y / 2;
+		const float corners[4][2] = { { -hw, -hh }, { hw, -hh }, { hw, hh }, { -hw, hh } };
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			float x = corners[i][0] * transform.scale.x;
+			float y = corners[i][1] * transform.scale.y;
+			quad[i].position = sf::Vector2f(transform.pos.x + x * c - y * s, transform.pos.y + x * s + y * c);
+		}
+	}
+
+	// the frames sit side by side in the texture, see CAnimation::frame
+	void FrameQuad(sf::Vertex* quad, uint32_t frame, const Vec2& size)
+	{
+		float u = frame * size.x;
+		quad[0].texCoords = sf::Vector2f(u, 0);
+		quad[1].texCoords = sf::Vector2f(u + size.x, 0);
+		quad[2].texCoords = sf::Vector2f(u + size.x, size.y);
+		quad[3].texCoords = sf::Vector2f(u, size.y);
+	}
+}
+
 Scene_Play::Scene_Play(GameEngine* gameEngine, const std::string& levelPath)
 	: Scene(gameEngine)
 	, m_levelPath(levelPath)
@@ -20,15 +87,19 @@ void Scene_Play::init(const std::string& levelPath)
 	{
 		PROFILE_SCOPE("Register Actions");
 
-		registerAction(sf::Keyboard::W,		 "JUMP");
-		registerAction(sf::Keyboard::A,		 "LEFT");
-		registerAction(sf::Keyboard::D,		 "RIGHT");
-		registerAction(sf::Keyboard::P,		 "PAUSE");
-		registerAction(sf::Keyboard::Space,  "SHOOT");
-		registerAction(sf::Keyboard::Escape, "QUIT");
-		registerAction(sf::Keyboard::T,		 "TOGGLE_TEXTURE");			// toggle drawing (T)extures
-		registerAction(sf::Keyboard::C,		 "TOGGLE_COLLISION");		// toggle drawing (C)ollision Boxes
-		registerAction(sf::Keyboard::G,		 "TOGGLE_GRID");			// toggle drawing (G)rid
+		registerAction(sf::Keyboard::W,		 ActionName::JUMP);
+		registerAction(sf::Keyboard::A,		 ActionName::LEFT);
+		registerAction(sf::Keyboard::D,		 ActionName::RIGHT);
+		registerAction(sf::Keyboard::P,		 ActionName::PAUSE);
+		registerAction(sf::Keyboard::Space,  ActionName::SHOOT);
+		registerAction(sf::Keyboard::Escape, ActionName::QUIT);
+		registerAction(sf::Keyboard::T,		 ActionName::TOGGLE_TEXTURE);		// toggle drawing (T)extures
+		registerAction(sf::Keyboard::C,		 ActionName::TOGGLE_COLLISION);	// toggle drawing (C)ollision Boxes
+		registerAction(sf::Keyboard::G,		 ActionName::TOGGLE_GRID);		// toggle drawing (G)rid
+		registerAction(sf::Keyboard::H,		 ActionName::TOGGLE_HUD);		// toggle the performance (H)UD
+		registerAction(sf::Keyboard::F5,	 ActionName::QUICKSAVE);
+		registerAction(sf::Keyboard::F8,	 ActionName::QUICKLOAD);
+		registerAction(sf::Keyboard::R,		 ActionName::REWIND);			// hold to (R)ewind
 	}
 
 	m_mouseShape.setRadius(8);
@@ -36,20 +107,48 @@ void Scene_Play::init(const std::string& levelPath)
 	m_mouseShape.setPointCount(32);
 	m_mouseShape.setFillColor(sf::Color(255,0,0,196));
 
+	{
+		PROFILE_SCOPE("Resolve Animations");
+
+		const Assets& assets = m_game->assets();
+		m_animations.stand		= assets.getAnimationHandle("Stand");
+		m_animations.run		= assets.getAnimationHandle("Run");
+		m_animations.air		= assets.getAnimationHandle("Air");
+		m_animations.explosion	= assets.getAnimationHandle("Explosion");
+		m_animations.coin		= assets.getAnimationHandle("Coin");
+		m_animations.question	= assets.getAnimationHandle("Question");
+		m_animations.question2	= assets.getAnimationHandle("Question2");
+		m_animations.brick		= assets.getAnimationHandle("Brick");
+		m_animations.pole		= assets.getAnimationHandle("Pole");
+		m_animations.poleTop	= assets.getAnimationHandle("PoleTop");
+	}
+
 	m_gridText.setCharacterSize(12);
 	m_gridText.setFont(m_game->assets().getFont("Arial"));
+	m_hud.init(m_game->assets().getFont("Arial"));
 
 	loadLevel(levelPath);
 }
 
 Vec2 Scene_Play::gridToMidPixel(float gridX, float gridY, Entity entity)
 {
-	const Vec2& animSize = entity.getComponent<CAnimation>().animation.getSize();
+	const Vec2& animSize = entity.getComponent<CAnimation>().size;
 
 	return Vec2((gridX * m_gridSize.x) + (animSize.x / 2),
 		        height() - (gridY * m_gridSize.y) - (animSize.y / 2));
 }
 
+Entity Scene_Play::player()
+{
+	return m_entityManager.getEntities(Tag::player)[0];
+}
+
+float Scene_Play::cameraX()
+{
+	// the view is centered on the player once they are far enough right
+	return std::max(width() / 2.0f, player().getComponent<CTransform>().pos.x);
+}
+
 void Scene_Play::loadLevel(const std::string& filename)
 {
 	PROFILE_FUNCTION();
@@ -57,44 +156,134 @@ void Scene_Play::loadLevel(const std::string& filename)
 	// reset the entity manager every time we load a level
 	m_entityManager = EntityManager();
 
-	std::ifstream file(filename);
-	std::string str;
+	// scenes may be preloaded on a worker thread, so this only parses the level,
+	// entities come from the shared memory pool and are spawned in onEnter
+	if (!m_streamer.open(filename, m_game->assets(), m_gridSize, height())) { return; }
 
-	float x, y;
-	while (file.good())
+	const LevelFile::LevelData& level = m_streamer.level();
+	if (level.hasPlayer)
 	{
-		file >> str;
-
-		if (str == "Tile")
+		m_playerConfig = level.player;
+		m_animations.weapon = m_game->assets().getAnimationHandle(m_playerConfig.WEAPON);
+		if (m_animations.weapon.valid())
 		{
-			file >> str >> x >> y;
-			Entity tile = m_entityManager.addEntity(Tag::tile);
-			tile.addComponent<CAnimation>(m_game->assets().getAnimation(str), true);
-			tile.addComponent<CTransform>(gridToMidPixel(x, y, tile));
-			tile.addComponent<CBoundingBox>(tile.getComponent<CAnimation>().animation.getSize());
-			tile.addComponent<CDraggable>();
+			m_projectiles.setShape(m_game->assets().getAnimation(m_animations.weapon).getSize(), m_gridSize.x);
 		}
-		else if (str == "Dec")
-		{
-			file >> str >> x >> y;
-			Entity dec = m_entityManager.addEntity(Tag::decoration);
-			dec.addComponent<CAnimation>(m_game->assets().getAnimation(str), true);
-			dec.addComponent<CTransform>(gridToMidPixel(x, y, dec));
-			dec.addComponent<CDraggable>();
-		}
-		else if (str == "Player")
+	}
+
+	// the map only has room for the chunks that can be spawned at once and is as tall as the window,
+	// what does not fit stays an entity
+	int rows = (int)std::ceil(height() / m_gridSize.y);
+	int chunks = (int)std::min(level.chunkCount(), m_streamer.residentChunks(width()));
+	m_tilemap.create((int)(level.chunkCount() * LevelFile::ChunkColumns), rows, m_gridSize, height(), chunks);
+
+	const Assets& assets = m_game->assets();
+	for (const std::string& name : level.types)
+	{
+		AnimationHandle animation = assets.getAnimationHandle(name);
+		if (animation.valid()) { m_tilemap.addType(assets.getAnimation(animation)); }
+	}
+	if (m_animations.question2.valid()) { m_tilemap.addType(assets.getAnimation(m_animations.question2)); }
+
+	m_tilemap.setBehaviour(m_tilemap.findType(m_animations.brick), TileBehaviour::Brick);
+	m_tilemap.setBehaviour(m_tilemap.findType(m_animations.question), TileBehaviour::Question);
+	m_tilemap.setBehaviour(m_tilemap.findType(m_animations.pole), TileBehaviour::Goal);
+	m_tilemap.setBehaviour(m_tilemap.findType(m_animations.poleTop), TileBehaviour::Goal);
+}
+
+void Scene_Play::onEnter()
+{
+	PROFILE_FUNCTION();
+
+	// the HUD stays up across level restarts
+	m_drawHUD = Profiler::Instance().statsEnabled();
+
+	if (!m_entityManager.getEntities().empty() || !m_streamer.level().hasPlayer) { return; }
+
+	// the camera follows the player, so the player has to exist before the first chunks stream in
+	spawnPlayer();
+	m_entityManager.update();
+	sStreaming();
+	m_entityManager.update();
+
+	// the level as it starts is as far back as a rewind can go
+	sRewind();
+
+	// build the scene we restart into when the level is won while this one is played
+	GameEngine* game = m_game;
+	std::string nextLevel = m_nextLevelPath;
+	m_game->preloadScene(nextLevel, [game, nextLevel]() { return std::make_shared<Scene_Play>(game, nextLevel); });
+}
+
+void Scene_Play::spawnChunks(const LevelStreamer::SpawnVec& spawns)
+{
+	PROFILE_FUNCTION();
+
+	for (auto& spawn : spawns)
+	{
+		// a record on a grid cell is only two bytes in the map
+		int column = (int)spawn.gridX;
+		int row = (int)spawn.gridY;
+		if (column == spawn.gridX && row == spawn.gridY && m_tilemap.contains(column, row))
 		{
-			file >> m_playerConfig.X >> m_playerConfig.Y >> m_playerConfig.CX >> m_playerConfig.CY;
-			file >> m_playerConfig.SPEED >> m_playerConfig.JUMP >> m_playerConfig.MAXSPEED >> m_playerConfig.GRAVITY >> m_playerConfig.WEAPON;
-			spawnPlayer();
+			Tilemap::TypeId type = m_tilemap.findType(spawn.animation);
+			if (type != 0)
+			{
+				m_tilemap.set(spawn.tag == Tag::tile ? LevelFile::Tile : LevelFile::Decoration, column, row, type);
+				continue;
+			}
 		}
-		else
+
+		Entity entity = m_entityManager.addEntity(spawn.tag);
+		entity.addComponent<CAnimation>(m_game->assets().getAnimation(spawn.animation), true);
+		entity.addComponent<CTransform>(spawn.pos);
+		if (spawn.tag == Tag::tile) { entity.addComponent<CBoundingBox>(spawn.size); }
+		entity.addComponent<CDraggable>();
+	}
+}
+
+void Scene_Play::despawnChunk(size_t chunk)
+{
+	PROFILE_FUNCTION();
+
+	// a chunk that changed is kept the way it is now, its entities come back as entities
+	bool keep = m_streamer.edited(chunk);
+	LevelStreamer::ChunkEdit edit;
+	edit.chunk = chunk;
+	if (keep) { m_tilemap.saveChunk(chunk, edit.tiles); }
+	m_tilemap.release(chunk);
+
+	// entities belong to the chunk their left edge is in, the same rule the level file uses
+	for (Tag tag : { Tag::tile, Tag::decoration })
+	{
+		for (Entity e : m_entityManager.getEntities(tag))
 		{
-			std::cerr << "Unknown Entity Type: " << str << " " << filename << std::endl;
+			if (e.hasComponent<CDraggable>() && e.getComponent<CDraggable>().dragging) { continue; }
+
+			const Vec2& pos = e.getComponent<CTransform>().pos;
+			const CAnimation& animation = e.getComponent<CAnimation>();
+			if (m_streamer.chunkOf(pos.x - animation.size.x / 2) != chunk) { continue; }
+
+			if (keep) { edit.spawns.push_back({ tag, animation.handle, pos, animation.size, -1, -1 }); }
+			e.destroy();
 		}
 	}
 
-	m_entityManager.update();
+	if (keep) { m_streamer.keepEdit(std::move(edit)); }
+}
+
+void Scene_Play::markEdited(Entity entity)
+{
+	// only the level's own entities go away with their chunk
+	if (entity.tag() != Tag::tile && entity.tag() != Tag::decoration) { return; }
+
+	float leftEdge = entity.getComponent<CTransform>().pos.x - entity.getComponent<CAnimation>().size.x / 2;
+	m_streamer.markEdited(m_streamer.chunkOf(leftEdge));
+}
+
+void Scene_Play::markEdited(const Tilemap::Tile& tile)
+{
+	m_streamer.markEdited((size_t)tile.column / LevelFile::ChunkColumns);
 }
 
 void Scene_Play::spawnPlayer()
@@ -104,12 +293,12 @@ void Scene_Play::spawnPlayer()
 	for (Entity entity : m_entityManager.getEntities(Tag::player)) { entity.destroy(); }
 
 	Entity player = m_entityManager.addEntity(Tag::player);
-	player.addComponent<CAnimation>(m_game->assets().getAnimation("Air"), true);
+	player.addComponent<CAnimation>(m_game->assets().getAnimation(m_animations.air), true);
 	player.addComponent<CTransform>(gridToMidPixel(m_playerConfig.X, m_playerConfig.Y, player));
 	player.addComponent<CInput>();
 	player.addComponent<CBoundingBox>(Vec2(48, 48));
 	player.addComponent<CGravity>(m_playerConfig.GRAVITY);
-	player.addComponent<CState>("air");
+	player.addComponent<CState>(PlayerState::Air);
 	player.addComponent<CDraggable>();
 }
 
@@ -118,35 +307,188 @@ void Scene_Play::hitBlock(Entity entity)
 	auto& tTransform = entity.getComponent<CTransform>();
 	auto& tAnimation = entity.getComponent<CAnimation>();
 
-	if (tAnimation.animation.getName() == "Brick")
+	if (tAnimation.handle == m_animations.brick)
 	{
-		entity.addComponent<CAnimation>(m_game->assets().getAnimation("Explosion"), false);
-		entity.removeComponent<CBoundingBox>();
+		explode(entity);
 	}
-	else if (tAnimation.animation.getName() == "Question")
+	else if (tAnimation.handle == m_animations.question)
 	{
-		tAnimation.animation = m_game->assets().getAnimation("Question2");
+		markEdited(entity);
+		entity.addComponent<CAnimation>(m_game->assets().getAnimation(m_animations.question2), tAnimation.repeat);
+		m_particles.emit(m_game->assets().getAnimation(m_animations.coin), Vec2(tTransform.pos.x, tTransform.pos.y - m_gridSize.y));
+	}
+}
+
+void Scene_Play::hitTile(const Tilemap::Tile& tile)
+{
+	TileBehaviour behaviour = m_tilemap.type(tile.type).behaviour;
 
-		Entity dec = m_entityManager.addEntity(Tag::decoration);
-		dec.addComponent<CAnimation>(m_game->assets().getAnimation("Coin"), false);
-		dec.addComponent<CTransform>(Vec2(tTransform.pos.x, tTransform.pos.y - m_gridSize.y));
+	if (behaviour == TileBehaviour::Brick)
+	{
+		explode(tile);
+	}
+	else if (behaviour == TileBehaviour::Question)
+	{
+		markEdited(tile);
+		m_tilemap.set(LevelFile::Tile, tile.column, tile.row, m_tilemap.findType(m_animations.question2));
+		m_particles.emit(m_game->assets().getAnimation(m_animations.coin), Vec2(tile.pos.x, tile.pos.y - m_gridSize.y));
 	}
 }
 
+void Scene_Play::explode(Entity tile)
+{
+	// the brick is gone at once, the explosion is only something to look at
+	m_particles.emit(m_game->assets().getAnimation(m_animations.explosion), tile.getComponent<CTransform>().pos);
+	markEdited(tile);
+	tile.removeComponent<CBoundingBox>();
+	tile.destroy();
+}
+
+void Scene_Play::explode(const Tilemap::Tile& tile)
+{
+	m_particles.emit(m_game->assets().getAnimation(m_animations.explosion), tile.pos);
+	markEdited(tile);
+	m_tilemap.set(LevelFile::Tile, tile.column, tile.row, 0);
+}
+
+void Scene_Play::promoteTile(size_t layer, const Tilemap::Tile& tile)
+{
+	// the tile leaves the map and carries on as an entity, the way every tile used to be
+	const Tilemap::TileType& type = m_tilemap.type(tile.type);
+	Entity entity = m_entityManager.addEntity(layer == LevelFile::Tile ? Tag::tile : Tag::decoration);
+	entity.addComponent<CAnimation>(m_game->assets().getAnimation(type.animation), true);
+	entity.addComponent<CTransform>(tile.pos);
+	if (layer == LevelFile::Tile) { entity.addComponent<CBoundingBox>(type.size); }
+	entity.addComponent<CDraggable>().dragging = true;
+
+	markEdited(tile);
+	m_tilemap.set(layer, tile.column, tile.row, 0);
+}
+
+void Scene_Play::quicksave()
+{
+	PROFILE_FUNCTION();
+
+	long long start = Profiler::Now();
+
+	// components are plain data, so the pool is a handful of memcpys and the rest is entity ids
+	EntityMemoryPool::Instance().snapshot(m_quicksave.pool);
+	m_quicksave.entities = m_entityManager;
+	m_streamer.save(m_quicksave.chunks);
+	m_quicksave.edits	 = m_streamer.edits();
+	m_projectiles.save(m_quicksave.projectiles);
+	m_tilemap.save(m_quicksave.tiles);
+	m_quicksave.valid	 = true;
+
+	std::printf("Quicksave: %zu entities, %zu KB in %.1f us\n", m_entityManager.getTotal(),
+		m_quicksave.pool.bytes() / 1024, (Profiler::Now() - start) / 1000.0);
+}
+
+void Scene_Play::quickload()
+{
+	if (!m_quicksave.valid) { return; }
+
+	PROFILE_FUNCTION();
+
+	long long start = Profiler::Now();
+
+	// the keys held right now still count, the saved ones were let go long ago
+	CInput input = player().getComponent<CInput>();
+
+	EntityMemoryPool::Instance().restore(m_quicksave.pool);
+	m_entityManager = m_quicksave.entities;
+	m_streamer.restoreEdits(m_quicksave.edits);
+	m_streamer.restore(m_quicksave.chunks);
+	m_projectiles.load(m_quicksave.projectiles);
+	m_tilemap.load(m_quicksave.tiles);
+
+	player().getComponent<CInput>() = input;
+
+	// the history led up to the world that was just left behind, and so did the effects
+	m_rewind.clear();
+	m_particles.clear();
+
+	std::printf("Quickload: %zu entities in %.1f us\n", m_entityManager.getTotal(), (Profiler::Now() - start) / 1000.0);
+}
+
+void Scene_Play::saveFrame(RewindBuffer::Frame& frame)
+{
+	PROFILE_FUNCTION();
+
+	frame.resize(SectionCount);
+
+	EntityMemoryPool::Instance().snapshot(m_rewindPool);
+	size_t counters[] = { (size_t)m_rewindPool.numEntities, m_rewindPool.numAllocated, m_rewindPool.firstFree, m_rewindPool.highWater };
+	frame[PoolCounters].assign((const uint8_t*)counters, (const uint8_t*)(counters + 4));
+
+	// the component arrays trade places with the frame's instead of being copied, both are rewritten every tick
+	for (size_t c = 0; c < EntityPoolSnapshot::ComponentCount; c++) { frame[Components + c].swap(m_rewindPool.components[c]); }
+	Store(frame[Tags], m_rewindPool.tags);
+	Store(frame[Active], m_rewindPool.active);
+	Store(frame[Allocated], m_rewindPool.allocated);
+	Store(frame[PageAllocated], m_rewindPool.pageAllocated);
+
+	m_rewindIds[0].clear();
+	m_rewindIds[1].clear();
+	AllocationTracker::Reserve(m_rewindIds[0], m_entityManager.getEntities().size());
+	AllocationTracker::Reserve(m_rewindIds[1], m_entityManager.getPending().size());
+	for (Entity e : m_entityManager.getEntities()) { m_rewindIds[0].push_back(e.id()); }
+	for (Entity e : m_entityManager.getPending()) { m_rewindIds[1].push_back(e.id()); }
+	Store(frame[Entities], m_rewindIds[0]);
+	Store(frame[Pending], m_rewindIds[1]);
+
+	m_streamer.save(frame[Chunks]);
+
+	m_projectiles.save(frame[Projectiles]);
+	m_tilemap.save(frame[Tiles]);
+}
+
+void Scene_Play::loadFrame(const RewindBuffer::Frame& frame)
+{
+	PROFILE_FUNCTION();
+
+	size_t counters[4];
+	std::memcpy(counters, frame[PoolCounters].data(), sizeof(counters));
+	m_rewindPool.numEntities	= (long long)counters[0];
+	m_rewindPool.numAllocated	= counters[1];
+	m_rewindPool.firstFree		= counters[2];
+	m_rewindPool.highWater		= counters[3];
+
+	for (size_t c = 0; c < EntityPoolSnapshot::ComponentCount; c++) { m_rewindPool.components[c] = frame[Components + c]; }
+	Load(frame[Tags], m_rewindPool.tags);
+	Load(frame[Active], m_rewindPool.active);
+	Load(frame[Allocated], m_rewindPool.allocated);
+	Load(frame[PageAllocated], m_rewindPool.pageAllocated);
+	EntityMemoryPool::Instance().restore(m_rewindPool);
+
+	Load(frame[Entities], m_rewindIds[0]);
+	Load(frame[Pending], m_rewindIds[1]);
+	m_entityManager.restore(m_rewindIds[0], m_rewindIds[1]);
+
+	m_streamer.restore(frame[Chunks]);
+
+	m_projectiles.load(frame[Projectiles]);
+	m_tilemap.load(frame[Tiles]);
+}
+
 void Scene_Play::spawnBullet(Entity entity)
 {
 	auto& transform = entity.getComponent<CTransform>();
-	Entity bullet	= m_entityManager.addEntity(Tag::bullet);
-	bullet.addComponent<CTransform>(transform.pos, Vec2(12 * transform.scale.x, 0), transform.scale, 0.0f);
-	bullet.addComponent<CAnimation>(m_game->assets().getAnimation(m_playerConfig.WEAPON), true);
-	bullet.addComponent<CBoundingBox>(bullet.getComponent<CAnimation>().animation.getSize());
-	bullet.addComponent<CLifespan>(60);
+	m_projectiles.spawn(transform.pos, Vec2(12 * transform.scale.x, 0), 60);
 }
 
 void Scene_Play::update()
 {
 	PROFILE_FUNCTION();
 
+	// rewinding replaces the simulation, it also works while paused to step back through a glitch
+	if (m_rewinding)
+	{
+		sRewind();
+		return;
+	}
+
+	sStreaming();
 	m_entityManager.update();
 
 	if (!m_paused)
@@ -154,9 +496,96 @@ void Scene_Play::update()
 		sLifespan();
 		sMovement();
 		sDraggable();
+		sProjectiles();
 		sCollision();
 		sAnimation();
+		sParticles();
+
+		m_currentFrame++;
+		sRewind();
+	}
+}
+
+void Scene_Play::sRewind()
+{
+	if (!m_rewind.enabled()) { return; }
+
+	PROFILE_FUNCTION();
+
+	if (!m_rewinding)
+	{
+		saveFrame(m_rewindFrame);
+		m_rewind.push(m_currentFrame, m_rewindFrame);
+		PROFILE_COUNTER("Rewind Bytes", m_rewind.bytes());
+		return;
+	}
+
+	// one tick back every frame, the world holds still on the oldest tick once the history runs out
+	if (m_currentFrame == 0 || !m_rewind.restore(m_currentFrame - 1, m_rewindFrame)) { return; }
+
+	// the keys held right now still count, not the ones held back then
+	CInput input = player().getComponent<CInput>();
+	loadFrame(m_rewindFrame);
+	player().getComponent<CInput>() = input;
+	m_particles.clear();
+	m_currentFrame--;
+}
+
+uint64_t Scene_Play::checksum()
+{
+	// the bullets and the map are not entities, they still decide what gets blown up
+	return m_tilemap.checksum(m_projectiles.checksum(Scene::checksum()));
+}
+
+void Scene_Play::sProjectiles()
+{
+	PROFILE_FUNCTION();
+
+	for (Entity tile : m_projectiles.update(m_entityManager.getEntities(Tag::tile), m_tilemap))
+	{
+		// two bullets can hit the same brick in one tick
+		if (!tile.hasComponent<CBoundingBox>()) { continue; }
+		if (tile.getComponent<CAnimation>().handle == m_animations.brick) { explode(tile); }
+	}
+
+	for (const Tilemap::Tile& tile : m_projectiles.mapHits())
+	{
+		if (m_tilemap.get(LevelFile::Tile, tile.column, tile.row) != tile.type) { continue; }
+		if (m_tilemap.type(tile.type).behaviour == TileBehaviour::Brick) { explode(tile); }
+	}
+
+	PROFILE_COUNTER("Bullets", m_projectiles.count());
+}
+
+void Scene_Play::sParticles()
+{
+	PROFILE_FUNCTION();
+
+	m_particles.update();
+	PROFILE_COUNTER("Particles", m_particles.count());
+}
+
+void Scene_Play::sStreaming()
+{
+	PROFILE_FUNCTION();
+
+	float left = cameraX() - width() / 2.0f;
+	m_streamer.update(left, left + width(), m_spawns, m_loads, m_unloads);
+
+	for (size_t chunk : m_unloads) { despawnChunk(chunk); }
+	for (size_t chunk : m_loads) { m_tilemap.claim(chunk); }
+	spawnChunks(m_spawns);
+
+	// the cells a changed chunk was kept with, its entities came with the spawns
+	for (size_t chunk : m_loads)
+	{
+		const LevelStreamer::ChunkEdit* edit = m_streamer.findEdit(chunk);
+		if (edit) { m_tilemap.loadChunk(chunk, edit->tiles); }
 	}
+
+	m_spawns.clear();
+	m_loads.clear();
+	m_unloads.clear();
 }
 
 void Scene_Play::sMovement()
@@ -176,13 +605,15 @@ void Scene_Play::sMovement()
 	{
 		playerInputSpeed.x -= m_playerConfig.SPEED;
 		pTransform.scale.x = -1.0f;
+		pTransform.moved();
 	}
 	if (pInput.right)
 	{
 		playerInputSpeed.x += m_playerConfig.SPEED;
 		pTransform.scale.x = 1.0f;
+		pTransform.moved();
 	}
-	if (pInput.up && pState.state != "air" && pInput.canJump)
+	if (pInput.up && pState.state != PlayerState::Air && pInput.canJump)
 	{
 		playerInputSpeed.y = m_playerConfig.JUMP;
 		pInput.canJump = false;
@@ -208,6 +639,7 @@ void Scene_Play::sMovement()
 
 		transform.prevPos = transform.pos;
 		transform.pos += transform.velocity;
+		if (transform.velocity.x != 0 || transform.velocity.y != 0) { transform.moved(); }
 	}
 }
 
@@ -222,13 +654,14 @@ void Scene_Play::sDraggable()
 		{
 			auto mousePosition = m_mouseShape.getPosition();
 			auto& eTransform   = draggable.getComponent<CTransform>();
-			auto& animSize     = draggable.getComponent<CAnimation>().animation.getSize();
+			auto& animSize     = draggable.getComponent<CAnimation>().size;
 
 			Vec2 p = Vec2(mousePosition.x + (animSize.x / 2) - (m_gridSize.x / 2),
 				          mousePosition.y - (animSize.y / 2) + (m_gridSize.y / 2));
 
 			eTransform.prevPos = eTransform.pos;
 			eTransform.pos = p;
+			eTransform.moved();
 
 			return; // assume there is only 1
 		}
@@ -258,63 +691,57 @@ void Scene_Play::sLifespan()
 void Scene_Play::sCollision()
 {
 	PROFILE_FUNCTION();
-	
-	const EntityVec& tiles = m_entityManager.getEntities(Tag::tile);
 
+	Entity player = m_entityManager.getEntities(Tag::player)[0];
+
+	// only tiles reaching into the area around the player can touch it, bullets are done by sProjectiles
+	// the map tiles come from the cells around the player, the few tiles that are entities are looked at in entity order
+	FrameVector<Entity> playerTiles(&m_game->frameArena());
 	{
-		PROFILE_SCOPE("Bullet/Tile Collisions");
+		PROFILE_SCOPE("Collision Candidates");
 
-		auto& bullets = m_entityManager.getEntities(Tag::bullet);
-		for (Entity bullet : bullets)
-		{
-			for (Entity tile : tiles)
-			{
-				if (!tile.hasComponent<CBoundingBox>()) { continue; }
+		// the player is pushed around while it resolves, the margin covers how far it can move
+		const float playerMargin = 2 * m_gridSize.x;
+		const Vec2& playerPos = player.getComponent<CTransform>().pos;
+		const Vec2& playerHalfSize = player.getComponent<CBoundingBox>().halfSize;
+		float playerLeft = playerPos.x - playerHalfSize.x - playerMargin;
+		float playerRight = playerPos.x + playerHalfSize.x + playerMargin;
 
-				// if we aren't overlapping, continue to next tile
-				Vec2 overlap = Physics::GetOverlap(bullet, tile);
-				if (overlap.x < 0 || overlap.y < 0) { continue; }
+		m_tilemap.query(playerPos, Vec2(playerHalfSize.x + playerMargin, playerHalfSize.y + playerMargin), m_nearbyTiles);
 
-				bullet.destroy();
-				if (tile.getComponent<CAnimation>().animation.getName() == "Brick")
-				{
-					tile.addComponent<CAnimation>(m_game->assets().getAnimation("Explosion"), false);
-					tile.removeComponent<CBoundingBox>();
-				}
-			}
+		for (Entity tile : m_entityManager.getEntities(Tag::tile))
+		{
+			// a tile without a bounding box can never overlap anything
+			if (!tile.hasComponent<CBoundingBox>()) { continue; }
+
+			float x = tile.getComponent<CTransform>().pos.x;
+			float halfWidth = tile.getComponent<CBoundingBox>().halfSize.x;
+			if (x + halfWidth >= playerLeft && x - halfWidth <= playerRight) { playerTiles.push_back(tile); }
 		}
 	}
 
 	{
 		PROFILE_SCOPE("Player/Tile Collisions");
 
-		Entity player = m_entityManager.getEntities(Tag::player)[0];
 		auto& pTransform = player.getComponent<CTransform>();
 		auto& pState = player.getComponent<CState>();
 		auto& pBoundingBox = player.getComponent<CBoundingBox>();
-		auto& pInput = player.getComponent<CInput>();
 
-		pState.state = "air";
-		for (Entity tile : tiles)
+		// pushes the player out of one tile, map tiles and entities alike
+		enum class Contact { None, Goal, FromBelow };
+		auto resolve = [&](const Vec2& pos, const Vec2& prevPos, const Vec2& halfSize, const Vec2& velocity, TileBehaviour behaviour)
 		{
 			// if we aren't overlapping, continue to next tile
-			Vec2 overlap = Physics::GetOverlap(player, tile);
-			if (overlap.x < 0 || overlap.y < 0) { continue; }
-
-			Vec2 prevOverlap = Physics::GetPreviousOverlap(player, tile);
-			auto& tTransform = tile.getComponent<CTransform>();
-			auto& tAnimation = tile.getComponent<CAnimation>();
+			Vec2 overlap = Physics::GetOverlap(pTransform.pos, pBoundingBox.halfSize, pos, halfSize);
+			if (overlap.x < 0 || overlap.y < 0) { return Contact::None; }
 
-			if (tAnimation.animation.getName() == "Pole" ||
-				tAnimation.animation.getName() == "PoleTop")
-			{
-				// you win. restart level.
-				m_game->changeScene("PLAY", std::make_shared<Scene_Play>(m_game, "level1.txt"));
-				return;
-			}
+			// you win. restart level.
+			if (behaviour == TileBehaviour::Goal) { return Contact::Goal; }
 
-			Vec2 diff = pTransform.pos - tTransform.pos;
+			Vec2 prevOverlap = Physics::GetOverlap(pTransform.prevPos, pBoundingBox.halfSize, prevPos, halfSize);
+			Vec2 diff = pTransform.pos - pos;
 			Vec2 shift(0, 0);
+			Contact contact = Contact::None;
 			// if there was a non-zero previous x overlap, then the collision came from y
 			if (prevOverlap.x > 0)
 			{
@@ -322,12 +749,12 @@ void Scene_Play::sCollision()
 				pTransform.velocity.y = 0;
 				if (diff.y < 0)
 				{
-					pState.state = "ground";
-					pTransform.pos += (tTransform.velocity);
+					pState.state = PlayerState::Ground;
+					pTransform.pos += velocity;
 				}
 				else
 				{
-					hitBlock(tile);
+					contact = Contact::FromBelow;
 				}
 			}
 			// if there was a non-zero previous y overlap, then the collision came from y
@@ -335,100 +762,168 @@ void Scene_Play::sCollision()
 			{
 				shift.x += diff.x > 0 ? overlap.x : -overlap.x;
 				pTransform.velocity.x = 0;
-				pTransform.pos += (tTransform.velocity);
+				pTransform.pos += velocity;
 
 			}
 			pTransform.pos += shift;
+			pTransform.moved();
+			return contact;
+		};
+
+		Contact contact = Contact::None;
+		pState.state = PlayerState::Air;
+		for (const Tilemap::Tile& tile : m_nearbyTiles)
+		{
+			// a tile of the map never moves
+			contact = resolve(tile.pos, tile.pos, tile.halfSize, Vec2(0, 0), m_tilemap.type(tile.type).behaviour);
+			if (contact == Contact::Goal) { break; }
+			if (contact == Contact::FromBelow) { hitTile(tile); }
+		}
+		for (size_t t = 0; t < playerTiles.size() && contact != Contact::Goal; t++)
+		{
+			Entity tile = playerTiles[t];
+			auto& tTransform = tile.getComponent<CTransform>();
+			TileBehaviour behaviour = m_tilemap.type(m_tilemap.findType(tile.getComponent<CAnimation>().handle)).behaviour;
+
+			contact = resolve(tTransform.pos, tTransform.prevPos, tile.getComponent<CBoundingBox>().halfSize, tTransform.velocity, behaviour);
+			if (contact == Contact::FromBelow) { hitBlock(tile); }
+		}
+
+		if (contact == Contact::Goal)
+		{
+			std::shared_ptr<Scene> next = m_game->takePreloadedScene(m_nextLevelPath);
+			if (!next) { next = std::make_shared<Scene_Play>(m_game, m_nextLevelPath); }
+			m_game->changeScene("PLAY", next);
+			return;
 		}
 
 		// respawn if lower than bottom of screen
 		if (pTransform.pos.y > height()) { spawnPlayer(); }
 		// block left side of screen
-		if (pTransform.pos.x < pBoundingBox.halfSize.x) { pTransform.pos.x = pBoundingBox.halfSize.x; }
+		if (pTransform.pos.x < pBoundingBox.halfSize.x)
+		{
+			pTransform.pos.x = pBoundingBox.halfSize.x;
+			pTransform.moved();
+		}
 	}
 }
 
-void Scene_Play::sDoAction(Action action)
+void Scene_Play::sDoAction(const Action& action)
 {
-	PROFILE_FUNCTION();
+	// the mouse moves on most ticks it is used at all
+	// so handle it before doing any other work
+	if (action.name() == ActionName::MOUSE_MOVE)
+	{
+		float xdiff = m_game->window().getView().getCenter().x - width() / 2;
+		float ydiff = m_game->window().getView().getCenter().y - height() / 2;
+		m_mouseShape.setPosition(action.pos().x + xdiff, action.pos().y + ydiff);
+		return;
+	}
 
-	Entity player	 = m_entityManager.getEntities(Tag::player)[0];
-	auto& pInput	 = player.getComponent<CInput>();
-	auto& pState	 = player.getComponent<CState>();
-	auto& pTransform = player.getComponent<CTransform>();
+	PROFILE_FUNCTION();
 
-	if (action.type() == "START")
-	{
-		if (action.name() == "JUMP")				  { pInput.up    = true;				  }
-		else if (action.name() == "SHOOT")			  { pInput.shoot = true;				  }
-		else if (action.name() == "LEFT")			  { pInput.left  = true;				  }
-		else if (action.name() == "DOWN")			  { pInput.down  = true;				  }
-		else if (action.name() == "RIGHT")			  { pInput.right = true;				  }
-		else if (action.name() == "TOGGLE_TEXTURE")	  { m_drawTextures   = !m_drawTextures;	  }
-		else if (action.name() == "TOGGLE_COLLISION") { m_drawCollisions = !m_drawCollisions; }
-		else if (action.name() == "TOGGLE_GRID")	  { m_drawGrid	     = !m_drawGrid;		  }
-		else if (action.name() == "PAUSE")			  { setPaused(!m_paused);				  }
-		else if (action.name() == "QUIT")			  { onEnd();							  }
-		else if (action.name() == "LEFT_CLICK")
+	if (action.type() == ActionType::START)
+	{
+		switch (action.name())
 		{
-			// first try and find a draggable entity
-			for (Entity draggable : m_entityManager.getEntities())
+			case ActionName::JUMP:				{ player().getComponent<CInput>().up	= true; break; }
+			case ActionName::SHOOT:				{ player().getComponent<CInput>().shoot = true; break; }
+			case ActionName::LEFT:				{ player().getComponent<CInput>().left	= true; break; }
+			case ActionName::DOWN:				{ player().getComponent<CInput>().down	= true; break; }
+			case ActionName::RIGHT:				{ player().getComponent<CInput>().right = true; break; }
+			case ActionName::TOGGLE_TEXTURE:	{ m_drawTextures   = !m_drawTextures;	break; }
+			case ActionName::TOGGLE_COLLISION:	{ m_drawCollisions = !m_drawCollisions;	break; }
+			case ActionName::TOGGLE_GRID:		{ m_drawGrid	   = !m_drawGrid;		break; }
+			case ActionName::TOGGLE_HUD:
+			{
+				// stats are only gathered while someone is looking at them
+				m_drawHUD = !m_drawHUD;
+				Profiler::Instance().enableStats(m_drawHUD);
+				break;
+			}
+			case ActionName::PAUSE:				{ setPaused(!m_paused);					break; }
+			case ActionName::QUIT:				{ onEnd();								break; }
+			case ActionName::QUICKSAVE:			{ quicksave();							break; }
+			case ActionName::QUICKLOAD:			{ quickload();							break; }
+			case ActionName::REWIND:			{ m_rewinding = true;					break; }
+			case ActionName::LEFT_CLICK:
 			{
-				// release tile
-				if (draggable.hasComponent<CDraggable>() && draggable.getComponent<CDraggable>().dragging)
+				// first try and find a draggable entity
+				for (Entity draggable : m_entityManager.getEntities())
 				{
-					auto mp = m_mouseShape.getPosition();
-					auto& eTransform = draggable.getComponent<CTransform>();
+					// release tile
+					if (draggable.hasComponent<CDraggable>() && draggable.getComponent<CDraggable>().dragging)
+					{
+						auto mp = m_mouseShape.getPosition();
+						auto& eTransform = draggable.getComponent<CTransform>();
 
-					draggable.getComponent<CDraggable>().dragging = false;
-					Vec2 p = gridToMidPixel((int)(mp.x / m_gridSize.x), (int)((height() - mp.y) / m_gridSize.y), draggable);  // for grid snapping
+						draggable.getComponent<CDraggable>().dragging = false;
+						Vec2 p = gridToMidPixel((int)(mp.x / m_gridSize.x), (int)((height() - mp.y) / m_gridSize.y), draggable);  // for grid snapping
 
-					eTransform.pos = p;
-					eTransform.prevPos = p;
+						eTransform.pos = p;
+						eTransform.prevPos = p;
+						eTransform.moved();
+						markEdited(draggable);
 
-					draggable.removeComponent<CDraggable>();
-					return; // we only want one
+						draggable.removeComponent<CDraggable>();
+						return; // we only want one
+					}
 				}
-			}
-			// couldn't find a draggable entity. make one.
-			{
-				float xdiff = m_game->window().getView().getCenter().x - m_game->window().getSize().x / 2;
-				float ydiff = m_game->window().getView().getCenter().y - m_game->window().getSize().y / 2;
-				Vec2 worldPos(action.pos().x + xdiff, action.pos().y + ydiff);
-
-				// check to see if any entity was clicked at this position
-				for (auto e : m_entityManager.getEntities())
+				// couldn't find a draggable entity. make one.
 				{
-					// if I have clicked inside this entity
-					if (e.hasComponent<CDraggable>() && Physics::IsInside(worldPos, e))
+					float xdiff = m_game->window().getView().getCenter().x - width() / 2;
+					float ydiff = m_game->window().getView().getCenter().y - height() / 2;
+					Vec2 worldPos(action.pos().x + xdiff, action.pos().y + ydiff);
+
+					// check to see if any entity was clicked at this position
+					for (auto e : m_entityManager.getEntities())
 					{
-						e.getComponent<CDraggable>().dragging = true;
-						return;
+						// if I have clicked inside this entity
+						if (e.hasComponent<CDraggable>() && Physics::IsInside(worldPos, e))
+						{
+							e.getComponent<CDraggable>().dragging = true;
+							markEdited(e);
+							return;
+						}
 					}
+
+					// or a tile of the map, which becomes an entity to be dragged
+					size_t layer;
+					Tilemap::Tile tile;
+					if (m_tilemap.pick(worldPos, layer, tile)) { promoteTile(layer, tile); }
 				}
+				break;
 			}
+			default: break;
 		}
 	}
-	else if (action.type() == "END") 
+	else if (action.type() == ActionType::END)
 	{
-		if (action.name() == "JUMP") 
-		{ 
-			if (pTransform.velocity.y < 0) { pTransform.velocity.y = 0; }
-			pInput.canJump = true;
-			pInput.up	   = false;
+		switch (action.name())
+		{
+			case ActionName::JUMP:
+			{
+				Entity p = player();
+				auto& pTransform = p.getComponent<CTransform>();
+				auto& pInput	 = p.getComponent<CInput>();
+				if (pTransform.velocity.y < 0) { pTransform.velocity.y = 0; }
+				pInput.canJump = true;
+				pInput.up	   = false;
+				break;
+			}
+			case ActionName::LEFT:	{ player().getComponent<CInput>().left  = false; break; }
+			case ActionName::DOWN:	{ player().getComponent<CInput>().down  = false; break; }
+			case ActionName::RIGHT: { player().getComponent<CInput>().right = false; break; }
+			case ActionName::REWIND: { m_rewinding = false; break; }
+			case ActionName::SHOOT:
+			{
+				auto& pInput	= player().getComponent<CInput>();
+				pInput.shoot	= false;
+				pInput.canShoot = true;
+				break;
+			}
+			default: break;
 		}
-		else if (action.name() == "LEFT")  { pInput.left  = false;	 }
-		else if (action.name() == "DOWN")  { pInput.down  = false;	 }
-		else if (action.name() == "RIGHT") { pInput.right = false;   }
-		else if (action.name() == "SHOOT") { pInput.shoot = false;
-											 pInput.canShoot = true; }
-	}
-
-	if (action.name() == "MOUSE_MOVE")
-	{
-		float xdiff = m_game->window().getView().getCenter().x - m_game->window().getSize().x / 2;
-		float ydiff = m_game->window().getView().getCenter().y - m_game->window().getSize().y / 2;
-		m_mouseShape.setPosition(action.pos().x + xdiff, action.pos().y + ydiff);
 	}
 }
 
@@ -441,25 +936,28 @@ void Scene_Play::sAnimation()
 	auto& pAnimation = player.getComponent<CAnimation>();
 
 	// set player animation based on state and input
-	if (pState.state == "air")
+	if (pState.state == PlayerState::Air)
 	{
-		player.addComponent<CAnimation>(m_game->assets().getAnimation("Air"), true);
+		if (pAnimation.handle != m_animations.air)
+		{
+			player.addComponent<CAnimation>(m_game->assets().getAnimation(m_animations.air), true);
+		}
 	}
-	else if (pState.state == "ground")
+	else if (pState.state == PlayerState::Ground)
 	{
 		auto& pInput = player.getComponent<CInput>();
 		if ((pInput.left || pInput.right) && !(pInput.left && pInput.right))
 		{
-			if (pAnimation.animation.getName() != "Run")
+			if (pAnimation.handle != m_animations.run)
 			{
-				player.addComponent<CAnimation>(m_game->assets().getAnimation("Run"), true);
+				player.addComponent<CAnimation>(m_game->assets().getAnimation(m_animations.run), true);
 			}
 		}
 		else
 		{
-			if (pAnimation.animation.getName() != "Stand")
+			if (pAnimation.handle != m_animations.stand)
 			{
-				player.addComponent<CAnimation>(m_game->assets().getAnimation("Stand"), true);
+				player.addComponent<CAnimation>(m_game->assets().getAnimation(m_animations.stand), true);
 			}
 		}
 	}
@@ -471,11 +969,11 @@ void Scene_Play::sAnimation()
 
 		auto& anim = e.getComponent<CAnimation>();
 
-		if (anim.repeat || !anim.animation.hasEnded())
+		if (anim.repeat || !anim.hasEnded())
 		{
-			anim.animation.update();
+			anim.update();
 		}
-		else if (anim.animation.hasEnded())
+		else if (anim.hasEnded())
 		{
 			e.destroy();
 		}
@@ -485,7 +983,7 @@ void Scene_Play::sAnimation()
 void Scene_Play::drawLine(const Vec2& p1, const Vec2& p2)
 {
 	sf::Vertex line[] = { sf::Vector2f(p1.x, p1.y), sf::Vector2f(p2.x, p2.y) };
-	m_game->window().draw(line, 2, sf::Lines);
+	m_game->draw(line, 2, sf::Lines);
 }
 
 void Scene_Play::sRender()
@@ -495,37 +993,106 @@ void Scene_Play::sRender()
 	Entity player = m_entityManager.getEntities(Tag::player)[0];
 
 	// color the background darker so you know that the game is paused
-	if (!m_paused) { m_game->window().clear(sf::Color(100, 100, 255)); }
-	else { m_game->window().clear(sf::Color(50, 50, 150)); }
+	if (!m_paused) { m_game->clear(sf::Color(100, 100, 255)); }
+	else { m_game->clear(sf::Color(50, 50, 150)); }
 
 	{
 		PROFILE_SCOPE("Camera View");
 		// set the viewport of the window to be centered on the player if it's far enough right
-		auto& pPos = player.getComponent<CTransform>().pos;
-		float windowCenterX = std::max(m_game->window().getSize().x / 2.0f, pPos.x);
+		float windowCenterX = cameraX();
 		sf::View view = m_game->window().getView();
-		view.setCenter(windowCenterX, m_game->window().getSize().y - view.getCenter().y);
+		view.setCenter(windowCenterX, height() - view.getCenter().y);
 		m_game->window().setView(view);
 	}
 
+	// everything that can be seen this frame, in entity order so sprites still overlap the same way
+	FrameVector<Entity> visible(&m_game->frameArena());
+	{
+		PROFILE_SCOPE("Cull");
+
+		const sf::View& view = m_game->window().getView();
+		float left		= view.getCenter().x - view.getSize().x / 2;
+		float right		= view.getCenter().x + view.getSize().x / 2;
+		float top		= view.getCenter().y - view.getSize().y / 2;
+		float bottom	= view.getCenter().y + view.getSize().y / 2;
+
+		const EntityVec& entities = m_entityManager.getEntities();
+		visible.reserve(entities.size());
+		for (Entity e : entities)
+		{
+			if (!e.hasComponent<CAnimation>()) { continue; }
+
+			// half the sprite's width plus height bounds it at any rotation
+			auto& transform = e.getComponent<CTransform>();
+			const Vec2& size = e.getComponent<CAnimation>().size;
+			float reach = (size.x * std::abs(transform.scale.x) + size.y * std::abs(transform.scale.y)) / 2;
+
+			if (transform.pos.x + reach < left || transform.pos.x - reach > right) { continue; }
+			if (transform.pos.y + reach < top  || transform.pos.y - reach > bottom) { continue; }
+			visible.push_back(e);
+		}
+	}
+
 	// draw all Entity textures / animations
 	if (m_drawTextures)
 	{
 		PROFILE_SCOPE("Draw Textures");
 
-		for (auto e : m_entityManager.getEntities())
+		// the map goes under the entities, its decorations under its tiles
+		m_tilemap.draw(m_game, m_game->window().getView(), LevelFile::Decoration, m_currentFrame);
+		m_tilemap.draw(m_game, m_game->window().getView(), LevelFile::Tile, m_currentFrame);
+
+		// an entity's quad is only placed again when its transform changed and only retextured when its frame did
+		// quads go out in entity order so sprites still overlap the same way, a run sharing a texture is one batch
+		size_t changedTransforms = 0;
+		const sf::Texture* texture = nullptr;
+		auto flush = [&]()
 		{
-			if (e.hasComponent<CAnimation>()) {
-				auto& transform = e.getComponent<CTransform>();
-				auto& animation = e.getComponent<CAnimation>().animation;
+			if (m_spriteVertices.empty()) { return; }
+
+			sf::RenderStates states;
+			states.texture = texture;
+			m_game->draw(m_spriteVertices.data(), m_spriteVertices.size(), sf::Quads, states);
+			m_spriteVertices.clear();
+		};
 
-				animation.getSprite().setRotation(transform.angle);
-				animation.getSprite().setPosition(transform.pos.x, transform.pos.y);
-				animation.getSprite().setScale(transform.scale.x, transform.scale.y);
+		for (auto e : visible)
+		{
+			auto& transform = e.getComponent<CTransform>();
+			auto& animation = e.getComponent<CAnimation>();
+			auto& sprite = e.hasComponent<CSprite>() ? e.getComponent<CSprite>() : e.addComponent<CSprite>();
 
-				m_game->window().draw(animation.getSprite());
+			uint32_t frame = animation.frame();
+			bool resized = !sprite.built || sprite.handle != animation.handle;
+			if (resized || sprite.version != transform.version)
+			{
+				PlaceQuad(sprite.quad, transform, animation.size);
+				sprite.version = transform.version;
+				changedTransforms++;
 			}
+			if (resized || sprite.frame != frame)
+			{
+				FrameQuad(sprite.quad, frame, animation.size);
+				sprite.frame = frame;
+			}
+			sprite.handle = animation.handle;
+			sprite.built = true;
+
+			const sf::Texture* spriteTexture = m_game->assets().getAnimation(animation.handle).getSprite().getTexture();
+			if (spriteTexture != texture) { flush(); }
+			texture = spriteTexture;
+			m_spriteVertices.insert(m_spriteVertices.end(), sprite.quad, sprite.quad + 4);
+		}
+		flush();
+		PROFILE_COUNTER("Changed Transforms", changedTransforms);
+
+		if (m_animations.weapon.valid())
+		{
+			m_projectiles.draw(m_game, m_game->assets().getAnimation(m_animations.weapon).getSprite().getTexture(), m_game->window().getView());
 		}
+
+		// the effects go over everything else
+		m_particles.draw(m_game, m_game->window().getView());
 	}
 
 	// draw the grid so that we can easily debug
@@ -548,11 +1115,11 @@ void Scene_Play::sRender()
 
 			for (float x = nextGridX; x < rightX; x += m_gridSize.x)
 			{
-				std::string xCell = std::to_string((int)x / (int)m_gridSize.x);
-				std::string yCell = std::to_string((int)y / (int)m_gridSize.y);
-				m_gridText.setString("(" + xCell + "," + yCell + ")");
+				char label[32];
+				std::snprintf(label, sizeof(label), "(%d,%d)", (int)x / (int)m_gridSize.x, (int)y / (int)m_gridSize.y);
+				m_gridText.setString(label);
 				m_gridText.setPosition(x + 3, height() - y - m_gridSize.y + 2);
-				m_game->window().draw(m_gridText);
+				m_game->draw(m_gridText);
 			}
 		}
 	}
@@ -562,26 +1129,50 @@ void Scene_Play::sRender()
 	{
 		PROFILE_SCOPE("Draw Collisions");
 
-		for (auto e : m_entityManager.getEntities())
+		// one shape reused for every box, a new one each time would allocate its vertices
+		sf::RectangleShape rect;
+		rect.setFillColor(sf::Color(0, 0, 0, 0));
+		rect.setOutlineColor(sf::Color::Red);
+		rect.setOutlineThickness(1);
+
+		for (auto e : visible)
 		{
 			if (e.hasComponent<CBoundingBox>())
 			{
 				auto& box		= e.getComponent<CBoundingBox>();
 				auto& transform = e.getComponent<CTransform>();
 
-				sf::RectangleShape rect;
 				rect.setSize(sf::Vector2f(box.size.x - 1, box.size.y - 1));
 				rect.setOrigin(sf::Vector2f(box.halfSize.x, box.halfSize.y));
 				rect.setPosition(transform.pos.x, transform.pos.y + 1);
-				rect.setFillColor(sf::Color(0, 0, 0, 0));
-				rect.setOutlineColor(sf::Color::Red);
-				rect.setOutlineThickness(1);
 
-				m_game->window().draw(rect);
+				m_game->draw(rect);
 			}
 		}
+
+		const sf::View& view = m_game->window().getView();
+		m_tilemap.query(Vec2(view.getCenter().x, view.getCenter().y), Vec2(view.getSize().x / 2, view.getSize().y / 2), m_nearbyTiles);
+		for (const Tilemap::Tile& tile : m_nearbyTiles)
+		{
+			rect.setSize(sf::Vector2f(2 * tile.halfSize.x - 1, 2 * tile.halfSize.y - 1));
+			rect.setOrigin(sf::Vector2f(tile.halfSize.x, tile.halfSize.y));
+			rect.setPosition(tile.pos.x, tile.pos.y + 1);
+			m_game->draw(rect);
+		}
+
+		const Vec2& half = m_projectiles.halfSize();
+		rect.setSize(sf::Vector2f(2 * half.x - 1, 2 * half.y - 1));
+		rect.setOrigin(sf::Vector2f(half.x, half.y));
+		for (size_t i = 0; i < m_projectiles.count(); i++)
+		{
+			Vec2 pos = m_projectiles.position(i);
+			rect.setPosition(pos.x, pos.y + 1);
+			m_game->draw(rect);
+		}
 	}
-	m_game->window().draw(m_mouseShape);
+	m_game->draw(m_mouseShape);
+
+	if (m_drawHUD) { m_hud.draw(m_game, m_entityManager, m_tilemap, m_projectiles.count()); }
 }
 
 void Scene_Play::onEnd()
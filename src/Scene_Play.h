@@ -6,13 +6,32 @@
 #include <memory>
 
 #include "EntityManager.h"
+#include "LevelFile.h"
+#include "LevelStreamer.h"
+#include "PerfHUD.h"
+#include "RewindBuffer.h"
+#include "ParticleSystem.h"
+#include "ProjectilePool.h"
+#include "Tilemap.h"
 
 class Scene_Play : public Scene
 {
-    struct PlayerConfig
+    // animations used by the systems, resolved once so hot paths never look up by name
+    struct AnimationHandles
     {
-        float X, Y, CX, CY, SPEED, MAXSPEED, JUMP, GRAVITY;
-        std::string WEAPON;
+        AnimationHandle stand, run, air, explosion, coin, question, question2, brick, pole, poleTop, weapon;
+    };
+
+    // the whole world as it was at the last quicksave
+    struct SaveState
+    {
+        bool                valid = false;
+        EntityPoolSnapshot  pool;
+        EntityManager       entities;
+        std::vector<uint8_t> chunks;
+        std::vector<LevelStreamer::ChunkEdit> edits;
+        std::vector<uint8_t> projectiles;
+        std::vector<uint8_t> tiles;
     };
 
 protected:
@@ -20,15 +39,43 @@ protected:
     bool            m_drawTextures   = true;
     bool            m_drawCollisions = false;
     bool            m_drawGrid       = false;
+    bool            m_drawHUD        = false;
     const Vec2      m_gridSize       = { 64, 64 };
     std::string     m_levelPath;
+    std::string     m_nextLevelPath  = "level1.txt";
     PlayerConfig    m_playerConfig;
+    AnimationHandles m_animations;
     sf::Text        m_gridText;
     sf::CircleShape m_mouseShape;
+    std::vector<sf::Vertex> m_spriteVertices;   // the entity quads that share a texture, drawn as one batch
+    PerfHUD         m_hud;
+    LevelStreamer   m_streamer;
+    Tilemap         m_tilemap;              // the level's tiles and decorations that sit on the grid, see Tilemap
+    ParticleSystem  m_particles;            // explosions and coins, see ParticleSystem
+    ProjectilePool  m_projectiles;          // the player's bullets, see ProjectilePool
+    LevelStreamer::SpawnVec m_spawns;       // reused every tick by sStreaming
+    std::vector<size_t>     m_loads;
+    std::vector<size_t>     m_unloads;
+    std::vector<Tilemap::Tile> m_nearbyTiles;       // reused by every map query
+    SaveState               m_quicksave;
+    RewindBuffer            m_rewind;
+    bool                    m_rewinding      = false;
+    RewindBuffer::Frame     m_rewindFrame;          // scratch for the tick being saved or restored
+    EntityPoolSnapshot      m_rewindPool;
+    std::vector<size_t>     m_rewindIds[2];
 
     void init(const std::string& levelPath);
 
     void loadLevel(const std::string& filename);
+    void spawnChunks(const LevelStreamer::SpawnVec& spawns);
+    void despawnChunk(size_t chunk);
+
+    // the chunk the entity or tile belongs to changed and is kept when it unloads, see LevelStreamer
+    void markEdited(Entity entity);
+    void markEdited(const Tilemap::Tile& tile);
+
+    Entity player();
+    float cameraX();
 
 public:
 
@@ -39,18 +86,35 @@ public:
     void spawnPlayer();
     void spawnBullet(Entity Entity);
 
+    void sStreaming();
     void sMovement();
     void sDraggable();
     void sLifespan();
     void sCollision();
     void sAnimation();
+    void sRewind();
+    void sProjectiles();
+    void sParticles();
 
     void hitBlock(Entity Entity);
+    void hitTile(const Tilemap::Tile& tile);
+    void explode(Entity tile);
+    void explode(const Tilemap::Tile& tile);
+    void promoteTile(size_t layer, const Tilemap::Tile& tile);
+
+    void quicksave();
+    void quickload();
+
+    // the world as rewind sections, see RewindBuffer
+    void saveFrame(RewindBuffer::Frame& frame);
+    void loadFrame(const RewindBuffer::Frame& frame);
 
     void drawLine(const Vec2& p1, const Vec2& p2);
 
     virtual void update() override;
-    virtual void sDoAction(Action action) override;
+    virtual void sDoAction(const Action& action) override;
     virtual void sRender() override;
+    virtual void onEnter() override;
     virtual void onEnd() override;
+    virtual uint64_t checksum() override;
 };
\ No newline at end of file
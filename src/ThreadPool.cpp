@@ -0,0 +1,51 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	// workers record scopes until they are joined, so the profiler has to be destroyed after the pool
+	Profiler::Instance();
+
+	for (size_t i = 0; i < threadCount; i++)
+	{
+		m_workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	// workers finish whatever is still queued before they exit
+	for (auto& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+size_t ThreadPool::size() const
+{
+	return m_workers.size();
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+			if (m_jobs.empty()) { return; }
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop();
+		}
+		job();
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <algorithm>
+
+// a fixed set of worker threads pulling jobs from a shared queue
+// jobs must not touch the window or upload anything to the GPU, that stays on the main thread
+class ThreadPool
+{
+	std::vector<std::thread>			m_workers;
+	std::queue<std::function<void()>>	m_jobs;
+	std::mutex							m_lock;
+	std::condition_variable				m_condition;
+	bool								m_stopping = false;
+
+	void workerLoop();
+
+public:
+
+	ThreadPool(size_t threadCount);
+	~ThreadPool();
+
+	static ThreadPool& Instance()
+	{
+		// leave one hardware thread for the main loop
+		static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	size_t size() const;
+
+	template <typename F>
+	auto submit(F&& job) -> std::future<decltype(job())>
+	{
+		typedef decltype(job()) ResultType;
+
+		// std::function needs a copyable target, so the task lives behind a shared_ptr
+		auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(job));
+		std::future<ResultType> result = task->get_future();
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_jobs.push([task]() { (*task)(); });
+		}
+		m_condition.notify_one();
+		return result;
+	}
+};
@@ -0,0 +1,409 @@
+#include "Tilemap.h"
+#include "Animation.h"
+#include "GameEngine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const int ChunkColumns = (int)LevelFile::ChunkColumns;
+}
+
+Tilemap::Tilemap()
+	: m_types(1)
+{
+
+}
+
+void Tilemap::create(int columns, int rows, const Vec2& cellSize, float height, int chunks)
+{
+	m_columns	= std::max(columns, 0);
+	m_rows		= std::max(rows, 0);
+	m_cellSize	= cellSize;
+	m_height	= height;
+
+	int levelChunks = (m_columns + ChunkColumns - 1) / ChunkColumns;
+	m_owners.assign(chunks > 0 ? std::min(chunks, levelChunks) : levelChunks, -1);
+	if (chunks <= 0)
+	{
+		for (size_t slot = 0; slot < m_owners.size(); slot++) { m_owners[slot] = (int)slot; }
+	}
+	m_ringColumns = (int)m_owners.size() * ChunkColumns;
+
+	m_types.assign(1, TileType());
+	m_reachColumns	= 1;
+	m_reachRows		= 1;
+
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		m_cells[layer].assign((size_t)m_ringColumns * m_rows, 0);
+		m_counts[layer] = 0;
+		m_caches[layer].built = false;
+	}
+}
+
+void Tilemap::claim(size_t chunk)
+{
+	if (m_owners.empty() || chunk * ChunkColumns >= (size_t)m_columns) { return; }
+
+	size_t slot = chunk % m_owners.size();
+	if (m_owners[slot] == (int)chunk) { return; }
+
+	clearSlot(slot);
+	m_owners[slot] = (int)chunk;
+}
+
+void Tilemap::release(size_t chunk)
+{
+	if (m_owners.empty()) { return; }
+
+	size_t slot = chunk % m_owners.size();
+	if (m_owners[slot] != (int)chunk) { return; }
+
+	clearSlot(slot);
+	m_owners[slot] = -1;
+}
+
+void Tilemap::clearSlot(size_t slot)
+{
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		for (int row = 0; row < m_rows; row++)
+		{
+			TypeId* cells = &m_cells[layer][(size_t)row * m_ringColumns + slot * ChunkColumns];
+			for (int column = 0; column < ChunkColumns; column++)
+			{
+				if (cells[column] != 0) { m_counts[layer]--; }
+				cells[column] = 0;
+			}
+		}
+		m_versions[layer]++;
+	}
+}
+
+void Tilemap::saveChunk(size_t chunk, std::vector<uint8_t>& data) const
+{
+	data.clear();
+	if (!holds((int)(chunk * ChunkColumns))) { return; }
+
+	data.resize(LayerCount * m_rows * ChunkColumns * sizeof(TypeId));
+	uint8_t* out = data.data();
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		for (int row = 0; row < m_rows; row++)
+		{
+			std::memcpy(out, &m_cells[layer][cell((int)(chunk * ChunkColumns), row)], ChunkColumns * sizeof(TypeId));
+			out += ChunkColumns * sizeof(TypeId);
+		}
+	}
+}
+
+void Tilemap::loadChunk(size_t chunk, const std::vector<uint8_t>& data)
+{
+	if (!holds((int)(chunk * ChunkColumns)) || data.size() != LayerCount * m_rows * ChunkColumns * sizeof(TypeId)) { return; }
+
+	const uint8_t* in = data.data();
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		for (int row = 0; row < m_rows; row++)
+		{
+			TypeId* cells = &m_cells[layer][cell((int)(chunk * ChunkColumns), row)];
+			for (int column = 0; column < ChunkColumns; column++)
+			{
+				if (cells[column] != 0) { m_counts[layer]--; }
+			}
+			std::memcpy(cells, in, ChunkColumns * sizeof(TypeId));
+			for (int column = 0; column < ChunkColumns; column++)
+			{
+				if (cells[column] != 0) { m_counts[layer]++; }
+			}
+			in += ChunkColumns * sizeof(TypeId);
+		}
+		m_versions[layer]++;
+	}
+}
+
+Tilemap::TypeId Tilemap::addType(const Animation& animation)
+{
+	TypeId found = findType(animation.getHandle());
+	if (found != 0) { return found; }
+
+	TileType type;
+	type.animation	= animation.getHandle();
+	type.size		= animation.getSize();
+	type.frameCount	= (uint32_t)std::max<size_t>(animation.getFrameCount(), 1);
+	type.speed		= (uint32_t)animation.getSpeed();
+	type.columns	= std::max((int)std::ceil(type.size.x / m_cellSize.x), 1);
+	type.rows		= std::max((int)std::ceil(type.size.y / m_cellSize.y), 1);
+
+	m_reachColumns	= std::max(m_reachColumns, type.columns);
+	m_reachRows		= std::max(m_reachRows, type.rows);
+
+	m_types.push_back(type);
+	return (TypeId)(m_types.size() - 1);
+}
+
+Tilemap::TypeId Tilemap::findType(AnimationHandle animation) const
+{
+	// a level uses a couple of dozen types at most
+	for (size_t t = 1; t < m_types.size(); t++)
+	{
+		if (m_types[t].animation == animation) { return (TypeId)t; }
+	}
+	return 0;
+}
+
+void Tilemap::setBehaviour(TypeId type, TileBehaviour behaviour)
+{
+	if (type != 0 && type < m_types.size()) { m_types[type].behaviour = behaviour; }
+}
+
+const Tilemap::TileType& Tilemap::type(TypeId type) const
+{
+	return m_types[type];
+}
+
+bool Tilemap::holds(int column) const
+{
+	return column >= 0 && column < m_columns && m_owners[(size_t)(column / ChunkColumns) % m_owners.size()] == column / ChunkColumns;
+}
+
+size_t Tilemap::cell(int column, int row) const
+{
+	return (size_t)row * m_ringColumns + ((size_t)(column / ChunkColumns) % m_owners.size()) * ChunkColumns + column % ChunkColumns;
+}
+
+bool Tilemap::contains(int column, int row) const
+{
+	return row >= 0 && row < m_rows && holds(column);
+}
+
+Tilemap::TypeId Tilemap::get(size_t layer, int column, int row) const
+{
+	return contains(column, row) ? m_cells[layer][cell(column, row)] : 0;
+}
+
+void Tilemap::set(size_t layer, int column, int row, TypeId type)
+{
+	if (!contains(column, row)) { return; }
+
+	TypeId& current = m_cells[layer][cell(column, row)];
+	if (current == type) { return; }
+	if (current == 0) { m_counts[layer]++; }
+	if (type == 0) { m_counts[layer]--; }
+	current = type;
+	m_versions[layer]++;
+}
+
+Tilemap::Tile Tilemap::tile(int column, int row, TypeId type) const
+{
+	const Vec2& size = m_types[type].size;
+
+	Tile tile;
+	tile.column		= column;
+	tile.row		= row;
+	tile.type		= type;
+	tile.pos		= Vec2((column * m_cellSize.x) + (size.x / 2), m_height - (row * m_cellSize.y) - (size.y / 2));
+	tile.halfSize	= Vec2(size.x / 2, size.y / 2);
+	return tile;
+}
+
+size_t Tilemap::count(size_t layer) const
+{
+	return m_counts[layer];
+}
+
+int Tilemap::columns() const
+{
+	return m_columns;
+}
+
+int Tilemap::rows() const
+{
+	return m_rows;
+}
+
+bool Tilemap::anchors(float left, float top, float right, float bottom, int& c0, int& r0, int& c1, int& r1) const
+{
+	// a tile reaches up and to the right of its cell, and one that only touches the edge of the box still counts
+	c0 = (int)std::floor(left / m_cellSize.x) - m_reachColumns;
+	c1 = (int)std::floor(right / m_cellSize.x);
+	r0 = (int)std::floor((m_height - bottom) / m_cellSize.y) - m_reachRows;
+	r1 = (int)std::floor((m_height - top) / m_cellSize.y);
+
+	c0 = std::max(c0, 0);
+	r0 = std::max(r0, 0);
+	c1 = std::min(c1, m_columns - 1);
+	r1 = std::min(r1, m_rows - 1);
+	return c0 <= c1 && r0 <= r1;
+}
+
+void Tilemap::query(const Vec2& pos, const Vec2& halfSize, std::vector<Tile>& tiles) const
+{
+	tiles.clear();
+
+	int c0, r0, c1, r1;
+	if (!anchors(pos.x - halfSize.x, pos.y - halfSize.y, pos.x + halfSize.x, pos.y + halfSize.y, c0, r0, c1, r1)) { return; }
+
+	const std::vector<TypeId>& cells = m_cells[LevelFile::Tile];
+	for (int column = c0; column <= c1; column++)
+	{
+		if (!holds(column)) { continue; }
+
+		for (int row = r0; row <= r1; row++)
+		{
+			TypeId type = cells[cell(column, row)];
+			if (type == 0) { continue; }
+
+			Tile t = tile(column, row, type);
+			if ((halfSize.x + t.halfSize.x) - std::abs(pos.x - t.pos.x) < 0) { continue; }
+			if ((halfSize.y + t.halfSize.y) - std::abs(pos.y - t.pos.y) < 0) { continue; }
+			tiles.push_back(t);
+		}
+	}
+}
+
+bool Tilemap::pick(const Vec2& pos, size_t& layer, Tile& picked) const
+{
+	int c0, r0, c1, r1;
+	if (!anchors(pos.x, pos.y, pos.x, pos.y, c0, r0, c1, r1)) { return false; }
+
+	for (size_t l : { (size_t)LevelFile::Tile, (size_t)LevelFile::Decoration })
+	{
+		for (int column = c0; column <= c1; column++)
+		{
+			if (!holds(column)) { continue; }
+
+			for (int row = r0; row <= r1; row++)
+			{
+				TypeId type = m_cells[l][cell(column, row)];
+				if (type == 0) { continue; }
+
+				// the same test as Physics::IsInside
+				Tile t = tile(column, row, type);
+				if (std::abs(t.pos.x - pos.x) > t.halfSize.x || std::abs(t.pos.y - pos.y) > t.halfSize.y) { continue; }
+
+				layer = l;
+				picked = t;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void Tilemap::save(std::vector<uint8_t>& data) const
+{
+	// the cells of each layer, then the owner of each slot
+	size_t cells = (size_t)m_ringColumns * m_rows;
+	size_t owners = m_owners.size() * sizeof(int);
+	data.resize(LayerCount * cells * sizeof(TypeId) + owners);
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		if (cells > 0) { std::memcpy(data.data() + layer * cells * sizeof(TypeId), m_cells[layer].data(), cells * sizeof(TypeId)); }
+	}
+	if (owners > 0) { std::memcpy(data.data() + LayerCount * cells * sizeof(TypeId), m_owners.data(), owners); }
+}
+
+void Tilemap::load(const std::vector<uint8_t>& data)
+{
+	size_t cells = (size_t)m_ringColumns * m_rows;
+	size_t owners = m_owners.size() * sizeof(int);
+	if (data.size() != LayerCount * cells * sizeof(TypeId) + owners) { return; }
+
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		if (cells > 0) { std::memcpy(m_cells[layer].data(), data.data() + layer * cells * sizeof(TypeId), cells * sizeof(TypeId)); }
+		m_counts[layer] = cells - std::count(m_cells[layer].begin(), m_cells[layer].end(), 0);
+		m_versions[layer]++;
+	}
+	if (owners > 0) { std::memcpy(m_owners.data(), data.data() + LayerCount * cells * sizeof(TypeId), owners); }
+}
+
+uint64_t Tilemap::checksum(uint64_t hash) const
+{
+	for (size_t layer = 0; layer < LayerCount; layer++)
+	{
+		const uint8_t* bytes = (const uint8_t*)m_cells[layer].data();
+		for (size_t i = 0; i < m_cells[layer].size() * sizeof(TypeId); i++) { hash = (hash ^ bytes[i]) * 1099511628211ull; }
+	}
+	const uint8_t* bytes = (const uint8_t*)m_owners.data();
+	for (size_t i = 0; i < m_owners.size() * sizeof(int); i++) { hash = (hash ^ bytes[i]) * 1099511628211ull; }
+	return hash;
+}
+
+uint32_t Tilemap::frame(const TileType& type, size_t tick) const
+{
+	return type.speed > 0 ? (uint32_t)(tick / type.speed) % type.frameCount : 0;
+}
+
+void Tilemap::build(LayerCache& cache, size_t layer, size_t tick)
+{
+	cache.batches.resize(m_types.size());
+	for (auto& batch : cache.batches) { batch.clear(); }
+
+	const std::vector<TypeId>& cells = m_cells[layer];
+	for (int row = cache.r0; row <= cache.r1; row++)
+	{
+		for (int column = cache.c0; column <= cache.c1; column++)
+		{
+			if (!holds(column)) { continue; }
+
+			TypeId type = cells[cell(column, row)];
+			if (type == 0) { continue; }
+
+			const TileType& t = m_types[type];
+			float u = frame(t, tick) * t.size.x;
+			float x = column * m_cellSize.x;
+			float y = m_height - (row * m_cellSize.y) - t.size.y;
+
+			std::vector<sf::Vertex>& batch = cache.batches[type];
+			batch.emplace_back(sf::Vector2f(x, y), sf::Vector2f(u, 0));
+			batch.emplace_back(sf::Vector2f(x + t.size.x, y), sf::Vector2f(u + t.size.x, 0));
+			batch.emplace_back(sf::Vector2f(x + t.size.x, y + t.size.y), sf::Vector2f(u + t.size.x, t.size.y));
+			batch.emplace_back(sf::Vector2f(x, y + t.size.y), sf::Vector2f(u, t.size.y));
+		}
+	}
+
+	cache.frames.resize(m_types.size());
+	for (size_t type = 1; type < m_types.size(); type++) { cache.frames[type] = frame(m_types[type], tick); }
+	cache.version = m_versions[layer];
+	cache.built = true;
+}
+
+void Tilemap::draw(GameEngine* game, const sf::View& view, size_t layer, size_t tick)
+{
+	if (m_counts[layer] == 0) { return; }
+
+	int c0, r0, c1, r1;
+	float left		= view.getCenter().x - view.getSize().x / 2;
+	float top		= view.getCenter().y - view.getSize().y / 2;
+	if (!anchors(left, top, left + view.getSize().x, top + view.getSize().y, c0, r0, c1, r1)) { return; }
+
+	// the view scrolls a cell at a time as far as the map is concerned, and most types never animate
+	LayerCache& cache = m_caches[layer];
+	bool stale = !cache.built || cache.version != m_versions[layer] || cache.c0 != c0 || cache.r0 != r0 || cache.c1 != c1 || cache.r1 != r1;
+	for (size_t type = 1; !stale && type < cache.batches.size(); type++)
+	{
+		stale = !cache.batches[type].empty() && cache.frames[type] != frame(m_types[type], tick);
+	}
+	if (stale)
+	{
+		cache.c0 = c0;
+		cache.r0 = r0;
+		cache.c1 = c1;
+		cache.r1 = r1;
+		build(cache, layer, tick);
+	}
+
+	for (size_t type = 1; type < cache.batches.size(); type++)
+	{
+		if (cache.batches[type].empty()) { continue; }
+
+		sf::RenderStates states;
+		states.texture = game->assets().getAnimation(m_types[type].animation).getSprite().getTexture();
+		game->draw(cache.batches[type].data(), cache.batches[type].size(), sf::Quads, states);
+	}
+}
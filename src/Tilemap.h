@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Common.h"
+#include "AssetHandle.h"
+#include "LevelFile.h"
+
+#include <vector>
+#include <cstdint>
+
+class Animation;
+class GameEngine;
+
+// what happens when the player jumps into a tile from below, or runs into it
+enum class TileBehaviour : unsigned char { None, Brick, Question, Goal };
+
+// the static geometry of a level, one dense grid of tile type ids per LevelFile layer
+//
+// the grid only holds the chunks that are streamed in, see LevelStreamer. It is a ring of chunk wide
+// slots, chunk c lives in slot c % slots once it is claimed, so its size follows the view and not the
+// level. A cell of a chunk that is not claimed reads as empty and cannot be written
+//
+// a level is mostly ground and blocks that never move, as entities every one of them carried a full set
+// of components and went through every system. Here a tile is two bytes, the renderer only walks the
+// cells in view and collision looks up the cells around a box instead of testing every tile
+//
+// a tile sits on its bottom left cell and may cover more cells up and to the right, like a pipe. A tile
+// that has to become something more, one that is dragged with the mouse, is taken out of the map and
+// spawned as an entity, see Scene_Play. Records between cells never go in the map, they stay entities
+class Tilemap
+{
+public:
+
+	typedef uint16_t TypeId;						// 0 is an empty cell
+
+	static const size_t LayerCount = 2;				// indexed by LevelFile::Layer
+
+	struct TileType
+	{
+		AnimationHandle	animation;
+		Vec2			size;
+		uint32_t		frameCount	= 1;
+		uint32_t		speed		= 0;			// ticks per frame, every tile of a type shows the same frame
+		int				columns		= 1;			// cells the tile covers from its bottom left one
+		int				rows		= 1;
+		TileBehaviour	behaviour	= TileBehaviour::None;
+	};
+
+	// one occupied cell as the box it puts in the world
+	struct Tile
+	{
+		int		column	= 0;
+		int		row		= 0;						// 0 is the bottom of the level
+		TypeId	type	= 0;
+		Vec2	pos;								// centre, the same placement as Scene_Play::gridToMidPixel
+		Vec2	halfSize;
+	};
+
+private:
+
+	std::vector<TileType>					m_types;				// m_types[0] is the empty cell
+	std::vector<TypeId>						m_cells[LayerCount];	// row major, m_ringColumns wide
+	size_t									m_counts[LayerCount] = {};
+	std::vector<int>						m_owners;				// the chunk each slot holds, -1 for none
+	int										m_ringColumns	= 0;
+	int										m_columns		= 0;	// of the whole level
+	int										m_rows			= 0;
+	Vec2									m_cellSize		= { 64, 64 };
+	float									m_height		= 0;
+	int										m_reachColumns	= 1;	// the most cells any type covers
+	int										m_reachRows		= 1;
+	uint32_t								m_versions[LayerCount] = {};	// changes with every write to a layer
+
+	// the quads draw() last built for a layer, one batch per type, kept while the same cells in view
+	// hold the same tiles showing the same frames
+	struct LayerCache
+	{
+		int										c0 = 0, r0 = 0, c1 = -1, r1 = -1;
+		uint32_t								version = 0;
+		bool									built = false;
+		std::vector<uint32_t>					frames;
+		std::vector<std::vector<sf::Vertex>>	batches;
+	};
+	LayerCache								m_caches[LayerCount];
+
+	// whether column's chunk is in its slot, and where its cells are in a row
+	bool holds(int column) const;
+	size_t cell(int column, int row) const;
+	void clearSlot(size_t slot);
+
+	uint32_t frame(const TileType& type, size_t tick) const;
+	void build(LayerCache& cache, size_t layer, size_t tick);
+
+	// the anchor cells a tile touching [left, right] x [top, bottom] can sit on, false if none are in the map
+	bool anchors(float left, float top, float right, float bottom, int& c0, int& r0, int& c1, int& r1) const;
+
+public:
+
+	Tilemap();
+
+	// an empty map without any types, row 0 is the bottom row and sits on pixel height, the bottom of the window
+	// with room for chunks chunks at once, 0 holds every chunk of the level and has them all claimed already
+	void create(int columns, int rows, const Vec2& cellSize, float height, int chunks = 0);
+
+	// gives chunk its slot with every cell empty, whatever chunk was there before is gone
+	void claim(size_t chunk);
+	void release(size_t chunk);
+
+	// the cells of one claimed chunk as bytes, for a chunk that unloads changed, see LevelStreamer::ChunkEdit
+	void saveChunk(size_t chunk, std::vector<uint8_t>& data) const;
+	void loadChunk(size_t chunk, const std::vector<uint8_t>& data);
+
+	// the type that draws animation, added the first time it is asked for
+	TypeId addType(const Animation& animation);
+	TypeId findType(AnimationHandle animation) const;
+	void setBehaviour(TypeId type, TileBehaviour behaviour);
+	const TileType& type(TypeId type) const;
+
+	bool contains(int column, int row) const;
+	TypeId get(size_t layer, int column, int row) const;
+	void set(size_t layer, int column, int row, TypeId type);
+
+	Tile tile(int column, int row, TypeId type) const;
+	size_t count(size_t layer) const;
+	int columns() const;
+	int rows() const;
+
+	// the tiles of the tile layer that touch the box, column by column from the left and bottom up in each
+	// touching counts, the same as Physics::GetOverlap
+	void query(const Vec2& pos, const Vec2& halfSize, std::vector<Tile>& tiles) const;
+
+	// the tile whose sprite holds pos, the tile layer is looked at before the decorations
+	bool pick(const Vec2& pos, size_t& layer, Tile& tile) const;
+
+	// every cell and which chunks hold them as bytes, the layout only changes with the map size, for save states and rewind
+	void save(std::vector<uint8_t>& data) const;
+	void load(const std::vector<uint8_t>& data);
+
+	// folds every cell and the chunks holding them into an FNV-1a hash, see Scene::checksum
+	uint64_t checksum(uint64_t hash) const;
+
+	// the cells of a layer that are in view, one draw call per type, animated on the scene's tick
+	// the quads are only built again when the cells in view, their tiles or their frames changed
+	void draw(GameEngine* game, const sf::View& view, size_t layer, size_t tick);
+};
@@ -0,0 +1,254 @@
+#include "TraceFile.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+// nothing in here is profiled, the writer runs on the profiler's own flush thread
+// and the exporter must not open a new trace over the one it is reading
+
+namespace
+{
+	uint64_t zigzag(long long value)
+	{
+		return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+	}
+
+	long long unzigzag(uint64_t value)
+	{
+		return (long long)(value >> 1) ^ -(long long)(value & 1);
+	}
+
+	// reads one varint, returns false instead of running past the end of a damaged chunk
+	bool readVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value)
+	{
+		value = 0;
+		for (int shift = 0; pos < end && shift < 64; shift += 7)
+		{
+			uint8_t byte = *pos++;
+			value |= (uint64_t)(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) { return true; }
+		}
+		return false;
+	}
+
+	// ids are handed out one after another, a name is always defined before it is used
+	// and a profiler never registers more threads than this, anything bigger is a damaged chunk
+	const uint64_t MaxThreads = 1 << 16;
+
+	void writeJsonName(std::ofstream& out, const std::string& name)
+	{
+		for (char c : name)
+		{
+			// names can be asset paths with backslashes in them, escaped so they read back unchanged
+			if (c == '"' || c == '\\')		{ out << '\\' << c; }
+			else if ((unsigned char)c < 0x20)	{ out << "\\u00" << "0123456789abcdef"[c >> 4] << "0123456789abcdef"[c & 15]; }
+			else								{ out << c; }
+		}
+	}
+
+	// chrome wants microseconds, keep the nanoseconds as a fraction
+	void writeMicroseconds(std::ofstream& out, long long ns)
+	{
+		out << ns / 1000 << '.' << (char)('0' + ns % 1000 / 100) << (char)('0' + ns % 100 / 10) << (char)('0' + ns % 10);
+	}
+}
+
+bool TraceFile::Writer::open(const std::string& path)
+{
+	m_stream = std::ofstream(path, std::ios::binary);
+	if (!m_stream) { return false; }
+
+	TraceHeader header = {};
+	std::memcpy(header.magic, Magic, 4);
+	header.version = Version;
+	m_stream.write((const char*)&header, sizeof(header));
+	m_bytesWritten = sizeof(header);
+
+	m_chunk.reserve(64 * 1024);
+	return true;
+}
+
+void TraceFile::Writer::writeVarint(uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		m_chunk.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	m_chunk.push_back((uint8_t)value);
+}
+
+uint32_t TraceFile::Writer::nameID(const char* name)
+{
+	auto it = m_names.find(name);
+	if (it != m_names.end()) { return it->second; }
+
+	// first use of a name, define it inline just ahead of the event that needs it
+	uint32_t id = (uint32_t)m_names.size();
+	m_names[name] = id;
+
+	size_t length = std::strlen(name);
+	m_chunk.push_back(String);
+	writeVarint(id);
+	writeVarint(length);
+	m_chunk.insert(m_chunk.end(), name, name + length);
+	return id;
+}
+
+void TraceFile::Writer::scope(size_t threadID, const char* name, long long start, long long end)
+{
+	if (threadID >= m_lastStart.size()) { m_lastStart.resize(threadID + 1, 0); }
+
+	uint32_t id = nameID(name);
+	m_chunk.push_back(Scope);
+	writeVarint(threadID);
+	writeVarint(id);
+	writeVarint(zigzag(start - m_lastStart[threadID]));
+	writeVarint((uint64_t)std::max(0LL, end - start));
+
+	m_lastStart[threadID] = start;
+}
+
+void TraceFile::Writer::counter(const char* name, long long time, long long value)
+{
+	uint32_t id = nameID(name);
+	m_chunk.push_back(Counter);
+	writeVarint(id);
+	writeVarint(zigzag(time - m_lastCounter));
+	writeVarint(zigzag(value));
+
+	m_lastCounter = time;
+}
+
+void TraceFile::Writer::flush()
+{
+	if (m_chunk.empty() || !m_stream) { return; }
+
+	uint32_t size = (uint32_t)m_chunk.size();
+	m_stream.write((const char*)&size, sizeof(size));
+	m_stream.write((const char*)m_chunk.data(), m_chunk.size());
+	m_stream.flush();
+
+	m_bytesWritten += sizeof(size) + m_chunk.size();
+	m_chunk.clear();
+	std::fill(m_lastStart.begin(), m_lastStart.end(), 0);
+	m_lastCounter = 0;
+}
+
+size_t TraceFile::Writer::bytesWritten() const
+{
+	return m_bytesWritten;
+}
+
+bool TraceFile::ExportJson(const std::string& tracePath, const std::string& jsonPath)
+{
+	std::ifstream in(tracePath, std::ios::binary | std::ios::ate);
+	std::streamoff fileSize = in ? (std::streamoff)in.tellg() : 0;
+	in.seekg(0);
+
+	TraceHeader header = {};
+	if (!in.read((char*)&header, sizeof(header)) || !std::equal(Magic, Magic + 4, header.magic) || header.version == 0 || header.version > Version)
+	{
+		std::cerr << "Not a valid trace: " << tracePath << std::endl;
+		return false;
+	}
+
+	std::ofstream out(jsonPath);
+	if (!out)
+	{
+		std::cerr << "Could not write: " << jsonPath << std::endl;
+		return false;
+	}
+
+	std::vector<std::string> names;
+	std::vector<uint8_t> chunk;
+	size_t events = 0;
+	bool damaged = false;
+
+	out << "{\"otherData\":{},\"traceEvents\":[";
+
+	uint32_t size = 0;
+	while (in.read((char*)&size, sizeof(size)))
+	{
+		// the size comes from the file, a chunk cut off or a damaged size is never read past the end
+		if ((std::streamoff)size > fileSize - (std::streamoff)in.tellg())
+		{
+			// the last chunk was cut off, everything before it is still good
+			damaged = true;
+			break;
+		}
+
+		chunk.resize(size);
+		if (!in.read((char*)chunk.data(), size))
+		{
+			damaged = true;
+			break;
+		}
+
+		std::vector<long long> lastStart;
+		long long lastCounter = 0;
+		const uint8_t* pos = chunk.data();
+		const uint8_t* end = pos + chunk.size();
+		while (pos < end && !damaged)
+		{
+			uint8_t kind = *pos++;
+			if (kind == String)
+			{
+				uint64_t id, length;
+				if (!readVarint(pos, end, id) || !readVarint(pos, end, length) || length > (uint64_t)(end - pos) || id > names.size()) { damaged = true; break; }
+
+				if (id >= names.size()) { names.resize(id + 1); }
+				names[id].assign((const char*)pos, length);
+				pos += length;
+			}
+			else if (kind == Scope)
+			{
+				uint64_t thread, id, delta, duration;
+				if (!readVarint(pos, end, thread) || !readVarint(pos, end, id) ||
+					!readVarint(pos, end, delta) || !readVarint(pos, end, duration) || thread >= MaxThreads) { damaged = true; break; }
+
+				if (thread >= lastStart.size()) { lastStart.resize(thread + 1, 0); }
+				long long start = lastStart[thread] + unzigzag(delta);
+				lastStart[thread] = start;
+
+				out << (events++ > 0 ? ",\n{" : "\n{");
+				out << "\"cat\":\"function\",";
+				out << "\"dur\":"; writeMicroseconds(out, (long long)duration); out << ',';
+				out << "\"name\":\""; writeJsonName(out, id < names.size() ? names[id] : "?"); out << "\",";
+				out << "\"ph\":\"X\",";
+				out << "\"pid\":0,";
+				out << "\"tid\":" << thread << ",";
+				out << "\"ts\":"; writeMicroseconds(out, start);
+				out << "}";
+			}
+			else if (kind == Counter)
+			{
+				uint64_t id, delta, value;
+				if (!readVarint(pos, end, id) || !readVarint(pos, end, delta) || !readVarint(pos, end, value)) { damaged = true; break; }
+
+				long long time = lastCounter + unzigzag(delta);
+				lastCounter = time;
+
+				out << (events++ > 0 ? ",\n{" : "\n{");
+				out << "\"name\":\""; writeJsonName(out, id < names.size() ? names[id] : "?"); out << "\",";
+				out << "\"ph\":\"C\",";
+				out << "\"pid\":0,";
+				out << "\"ts\":"; writeMicroseconds(out, time); out << ',';
+				out << "\"args\":{\"value\":" << unzigzag(value) << "}";
+				out << "}";
+			}
+			else
+			{
+				damaged = true;
+			}
+		}
+		if (damaged) { break; }
+	}
+
+	out << "]}";
+
+	if (damaged) { std::cerr << "Trace ends in a damaged chunk, exported what came before it\n"; }
+	std::cout << "Exported " << events << " events to " << jsonPath << std::endl;
+	return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <cstdint>
+
+// Binary profiler trace written by the Profiler (results.trace)
+//
+// Layout, little endian:
+//   TraceHeader
+//   chunks of [uint32 payload size][payload] until the end of the file
+//
+// a payload is a run of events, each a Kind byte followed by unsigned LEB128 varints:
+//   String  id, length, then length bytes of name
+//   Scope   threadID, name id, zigzag start delta, duration
+//   Counter name id, zigzag time delta, zigzag value
+//
+// times are nanoseconds, start deltas are against the previous scope of the same thread
+// (or the previous counter sample) and restart from zero in every chunk. Chunks are written
+// whole and flushed, so a trace cut short by a crash still reads back up to the last complete chunk
+namespace TraceFile
+{
+	const char		Magic[4]	= { 'S', 'F', 'T', 'R' };
+	const uint32_t	Version		= 2;		// 2 added Counter, version 1 traces still read
+
+	enum Kind : uint8_t { String = 1, Scope = 2, Counter = 3 };
+
+	struct TraceHeader
+	{
+		char		magic[4];
+		uint32_t	version;
+		uint64_t	reserved;
+	};
+
+	static_assert(sizeof(TraceHeader) == 16, "trace layout must not depend on the compiler");
+
+	class Writer
+	{
+		std::ofstream							m_stream;
+		std::vector<uint8_t>					m_chunk;
+		std::unordered_map<const char*, uint32_t> m_names;	// names are stable pointers, see Profiler::intern
+		std::vector<long long>					m_lastStart;	// per thread, reset every chunk
+		long long								m_lastCounter = 0;
+		size_t									m_bytesWritten = 0;
+
+		void writeVarint(uint64_t value);
+		uint32_t nameID(const char* name);
+
+	public:
+
+		bool open(const std::string& path);
+		void scope(size_t threadID, const char* name, long long start, long long end);
+		void counter(const char* name, long long time, long long value);
+		void flush();
+
+		size_t bytesWritten() const;
+	};
+
+	// Chrome trace event JSON, which chrome://tracing and ui.perfetto.dev both open
+	bool ExportJson(const std::string& tracePath, const std::string& jsonPath);
+}
@@ -7,10 +7,123 @@
 #include <SFML/Graphics.hpp>
 
 #include "GameEngine.h"
+#include "AssetBundle.h"
+#include "LevelFile.h"
+#include "TraceFile.h"
+#include "RewindBuffer.h"
 
-int main()
+#include <cstring>
+#include <cstdlib>
+
+int main(int argc, char* argv[])
 {
+	// offline tools
+	if (argc == 4 && std::strcmp(argv[1], "--bundle") == 0)
+	{
+		// SFMLGame --bundle assets.txt assets.bundle
+		return AssetBundle::Build(argv[2], argv[3]) ? 0 : 1;
+	}
+	if (argc == 4 && std::strcmp(argv[1], "--convert-level") == 0)
+	{
+		// SFMLGame --convert-level level1.txt level1.lvl
+		return LevelFile::Convert(argv[2], argv[3]) ? 0 : 1;
+	}
+	if (argc == 4 && std::strcmp(argv[1], "--export-trace") == 0)
+	{
+		// SFMLGame --export-trace results.trace results.json
+		// this runs before anything is profiled, so the trace being read is never reopened for writing
+		return TraceFile::ExportJson(argv[2], argv[3]) ? 0 : 1;
+	}
+
+	std::string recordPath;
+	std::string replayPath;
+	bool headless = false;
+	bool poolReport = false;
+	EntityPoolConfig poolConfig;
+
+	// profiling is off until something arms it, F9 in game captures a few seconds
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--profile-all") == 0)
+		{
+			Profiler::Instance().captureAll();
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--profile-frames") == 0)
+		{
+			// SFMLGame --profile-frames 600, the first 600 frames including start up
+			Profiler::Instance().captureFrames((size_t)std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--track-allocations") == 0)
+		{
+			// prints every frame that allocates and which scopes did it
+			// needs a build configured with -DTRACK_ALLOCATIONS=ON, otherwise nothing reaches the tracker
+#ifndef TRACK_ALLOCATIONS
+			std::cerr << "--track-allocations: built without TRACK_ALLOCATIONS, no allocations will be seen" << std::endl;
+#endif
+			Profiler::Instance().trackAllocations(AllocationTracker::Report);
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--profile-slow") == 0)
+		{
+			// SFMLGame --profile-slow 20, every frame that takes 20ms or longer
+			Profiler::Instance().captureSlowFrames((float)std::atof(argv[++i]));
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--record") == 0)
+		{
+			// SFMLGame --record session.rec, every action of the session keyed by tick
+			recordPath = argv[++i];
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--replay") == 0)
+		{
+			// SFMLGame --replay session.rec [--headless], plays it back at full speed and reports the tick times
+			replayPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--pool-page-size") == 0)
+		{
+			// SFMLGame --pool-page-size 1024, entities added to the pool each time it grows
+			poolConfig.pageSize = (size_t)std::atoll(argv[++i]);
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--pool-capacity") == 0)
+		{
+			// SFMLGame --pool-capacity 50000, the most entities the pool may ever hold
+			poolConfig.maxEntities = (size_t)std::atoll(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--pool-report") == 0)
+		{
+			// prints how full every page of the pool is on exit
+			poolReport = true;
+		}
+		else if (i + 1 < argc && std::strcmp(argv[i], "--rewind-seconds") == 0)
+		{
+			// SFMLGame --rewind-seconds 10, how far back holding R can go, 0 stops recording the history
+			// a tick needs its keyframe in the history, so the usable part is between ticks - interval and ticks,
+			// the interval being a second, or half the history when that is shorter than two
+			RewindBuffer::Configure((size_t)(std::atof(argv[++i]) * 60));
+		}
+	}
+
+	// before anything creates an entity
+	EntityMemoryPool::Configure(poolConfig);
+
+	if (headless && replayPath.empty())
+	{
+		std::cerr << "--headless needs a --replay to drive it\n";
+		return 1;
+	}
+
 	PROFILE_FUNCTION();
-	GameEngine g("assets.txt");
+
+	// ship with assets.bundle next to the executable for the fastest start up
+	// rebuild it with --bundle whenever assets.txt or the images change
+	std::string assetsPath = std::ifstream("assets.bundle").good() ? "assets.bundle" : "assets.txt";
+
+	GameEngine g(assetsPath, headless);
+	if (!recordPath.empty() && !g.record(recordPath)) { return 1; }
+	if (!replayPath.empty() && !g.replay(replayPath)) { return 1; }
 	g.run();
-}
\ No newline at end of file
+
+	if (poolReport) { EntityMemoryPool::Instance().report(std::cout); }
+}
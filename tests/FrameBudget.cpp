@@ -0,0 +1,452 @@
+/* Frame budget regression test
+ *
+ * plays a scenario through Scene_Play on a headless engine a few times, collects the per system timings
+ * the profiler keeps for the HUD and compares each scope's median run against a baseline measured on
+ * the same machine. run from bin/ so the assets resolve:
+ *   FrameBudgetTest [--baseline frame_budget.txt] [--replay session.rec] [--tolerance percent] [--update]
+ *
+ * timings only mean something on the machine and build that took them, so no baseline is checked in.
+ * --update measures one, taking the scopes and tolerances from --scopes when there is none for this machine,
+ * --create does the same only when the baseline is missing or was measured on another machine or build
+ *   FrameBudgetTest --baseline build/frame_budget.txt --scopes tests/frame_budget.txt --create
+ *
+ * the scripted scenario runs level1 with a crowd of off grid blocks and bushes added to every column,
+ * so the systems have enough entities to take measurable time, a --replay plays its own recording instead
+ *
+ * --slowdown 2 stretches every frame to twice as long, the gate has to catch that (frame_budget_slowdown)
+ *
+ * with --assert-zero-allocs the script plays level1 as it ships and checks that no frame allocates on the
+ * main thread once the rewind history has filled instead, timings are not compared since the tracking itself costs time
+ *   FrameBudgetTest --assert-zero-allocs [--replay session.rec]
+ */
+
+#include "GameEngine.h"
+#include "Scene_Play.h"
+#include "Action.h"
+#include "RewindBuffer.h"
+
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <sys/utsname.h>
+#endif
+
+#ifndef BUILD_TYPE
+#define BUILD_TYPE ""
+#endif
+
+namespace
+{
+	const size_t Warmup		= 60;		// ticks before measuring, covers the menu and the level load
+	const size_t Ticks		= 1200;		// length of the scripted scenario
+	const float	 Tolerance	= 50;		// percent, for scopes added by --update
+	const size_t Runs		= 5;		// the median run is compared, one run disturbed by the machine does not fail
+
+	const char*	 LevelPath		= "level1.txt";		// the level the crowd is added to
+	const int	 CrowdPerColumn	= 24;				// off grid entities added to every column of it
+
+	// the rewind history grows its entries until it first wraps, allocations are only checked after that
+	const size_t AllocationWarmup = Warmup + RewindBuffer::DefaultTicks;
+
+	// the systems a new baseline starts with
+	const char* DefaultScopes[] = { "Frame", "Simulate", "Render", "sStreaming", "sLifespan", "sMovement", "sProjectiles", "sCollision", "sAnimation", "sParticles", "sRewind", "sRender" };
+
+	struct Budget
+	{
+		std::string	scope;
+		float		milliseconds	= 0;
+		float		tolerance		= Tolerance;
+	};
+
+	struct Baseline
+	{
+		std::vector<std::string>	header;		// comment lines, kept when the file is rewritten
+		std::vector<Budget>			budgets;
+		float						floor = 0.001f;
+		std::string					measured;	// the machine and build the budgets were taken on, empty for a scope list
+	};
+
+	// host, system, architecture and build type, one line with no spaces between the fields' own words
+	std::string ThisMachine()
+	{
+		std::string host = "unknown", system = "unknown", arch = "unknown";
+#ifdef _WIN32
+		if (const char* name = std::getenv("COMPUTERNAME")) { host = name; }
+		if (const char* name = std::getenv("PROCESSOR_ARCHITECTURE")) { arch = name; }
+		system = "Windows";
+#else
+		utsname name;
+		if (uname(&name) == 0)
+		{
+			host = name.nodename;
+			system = name.sysname;
+			arch = name.machine;
+		}
+#endif
+		std::string build = BUILD_TYPE;
+		return host + " " + system + " " + arch + " " + (build.empty() ? "NoBuildType" : build);
+	}
+
+	bool LoadBaseline(const std::string& path, Baseline& baseline)
+	{
+		std::ifstream file(path);
+		if (!file) { return false; }
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty()) { continue; }
+			if (line[0] == '#')
+			{
+				baseline.header.push_back(line);
+				continue;
+			}
+
+			std::stringstream ss(line);
+			std::string type;
+			ss >> type;
+			if (type == "Floor")
+			{
+				ss >> baseline.floor;
+			}
+			else if (type == "Measured")
+			{
+				std::getline(ss >> std::ws, baseline.measured);
+			}
+			else if (type == "Budget")
+			{
+				Budget budget;
+				ss >> budget.scope >> budget.milliseconds >> budget.tolerance;
+				baseline.budgets.push_back(budget);
+			}
+			else if (type == "Scope")
+			{
+				// a scope to measure, --update turns it into a Budget
+				Budget budget;
+				budget.milliseconds = -1;
+				ss >> budget.scope >> budget.tolerance;
+				baseline.budgets.push_back(budget);
+			}
+		}
+		return true;
+	}
+
+	bool SaveBaseline(const std::string& path, const Baseline& baseline)
+	{
+		std::ofstream file(path);
+		if (!file) { return false; }
+
+		for (auto& line : baseline.header) { file << line << "\n"; }
+		file << "\nMeasured " << baseline.measured << "\n";
+		file << "Floor " << baseline.floor << "\n\n";
+		for (auto& budget : baseline.budgets)
+		{
+			char line[256];
+			std::snprintf(line, sizeof(line), "Budget %-16s %8.4f %6.1f\n", budget.scope.c_str(), budget.milliseconds, budget.tolerance);
+			file << line;
+		}
+		return true;
+	}
+
+	// GCC names a PROFILE_FUNCTION scope "sRender", MSVC "Scene_Play::sRender"
+	bool Matches(const char* name, const std::string& scope)
+	{
+		size_t length = std::strlen(name);
+		if (length < scope.size() || std::strcmp(name + length - scope.size(), scope.c_str()) != 0) { return false; }
+		return length == scope.size() || (length > scope.size() + 1 && name[length - scope.size() - 1] == ':');
+	}
+
+	bool FindScope(const std::string& scope, ProfileStats::Summary& summary)
+	{
+		ProfileStats::Summary all[ProfileStats::MaxScopes];
+		size_t count = Profiler::Instance().stats().top(all, ProfileStats::MaxScopes);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (Matches(all[i].name, scope))
+			{
+				summary = all[i];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// level1 with the crowd appended, written to the temp directory so nothing lands next to the assets
+	std::string WriteCrowdLevel()
+	{
+		std::ifstream in(LevelPath);
+		if (!in) { return ""; }
+
+		std::string path = (std::filesystem::temp_directory_path() / "frame_budget_level.txt").string();
+		std::ofstream out(path);
+		out << in.rdbuf() << "\n";
+
+		// blocks along the top of the screen where nothing reaches them, bushes and clouds in the sky below,
+		// all half a cell off the grid so they stay entities instead of going into the tilemap
+		int columns = 0;
+		in.clear();
+		in.seekg(0);
+		std::string type, animation;
+		float x, y;
+		while (in >> type >> animation >> x >> y) { columns = std::max(columns, (int)x + 1); }
+
+		for (int column = 0; column < columns; column++)
+		{
+			for (int i = 0; i < CrowdPerColumn; i++)
+			{
+				float gridX = column + 0.5f + (float)(i % 3) / 8;
+				if (i % 4 == 0)			{ out << "Tile Block " << gridX << " " << 10.5f + (float)(i % 2) / 4 << "\n"; }
+				else if (i % 4 == 1)	{ out << "Dec CloudSmall " << gridX << " " << 7.5f + (float)(i % 5) / 4 << "\n"; }
+				else					{ out << "Dec Bush " << gridX << " " << 5.5f + (float)(i % 7) / 4 << "\n"; }
+			}
+		}
+		return out ? path : "";
+	}
+
+	// a headless engine driven tick by tick, either from a recording or from the script below
+	class BudgetEngine : public GameEngine
+	{
+		// runs right through the crowded level, jumping and shooting on a fixed rhythm
+		void script(size_t tick)
+		{
+			auto send = [this](ActionName name, ActionType type) { currentScene()->doAction(Action(name, type)); };
+
+			if (tick == 2)
+			{
+				waitForAssets();
+				changeScene("PLAY", std::make_shared<Scene_Play>(this, m_levelPath));
+			}
+			if (tick == 30)		{ send(ActionName::RIGHT, ActionType::START); }
+			if (tick == Ticks - 100) { send(ActionName::RIGHT, ActionType::END); }
+
+			if (tick >= 30 && tick % 60 == 0) { send(ActionName::JUMP, ActionType::START); }
+			if (tick >= 30 && tick % 60 == 20) { send(ActionName::JUMP, ActionType::END); }
+			if (tick >= 30 && tick % 10 == 0) { send(ActionName::SHOOT, ActionType::START); }
+			if (tick >= 30 && tick % 10 == 5) { send(ActionName::SHOOT, ActionType::END); }
+		}
+
+	public:
+
+		bool		m_assertZeroAllocs	= false;
+		float		m_slowdown			= 1;
+		std::string	m_levelPath;
+
+		BudgetEngine(const std::string& path)
+			: GameEngine(path, true)
+		{
+
+		}
+
+		void runScenario()
+		{
+			bool scripted = !m_replay.playing();
+			while (isRunning())
+			{
+				if (m_tick == Warmup) { Profiler::Instance().enableStats(true); }
+				if (m_tick == AllocationWarmup && m_assertZeroAllocs) { Profiler::Instance().trackAllocations(AllocationTracker::AssertZero); }
+				if (scripted)
+				{
+					if (m_tick == Ticks) { break; }
+					script(m_tick);
+				}
+
+				long long start = Profiler::Now();
+				Profiler::Instance().beginFrame();
+				update();
+
+				// spins for the rest of the slowed down frame, inside the Frame scope but outside every system
+				long long until = start + (long long)((Profiler::Now() - start) * m_slowdown);
+				while (Profiler::Now() < until) {}
+			}
+
+			Profiler::Instance().beginFrame();
+			Profiler::Instance().trackAllocations(AllocationTracker::Off);
+			m_replay.finish(m_tick, m_activeScene->checksum());
+		}
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	std::string baselinePath = "frame_budget.txt";
+	std::string scopesPath;
+	std::string replayPath;
+	float tolerance = -1;
+	bool update = false;
+	bool create = false;
+	bool assertZeroAllocs = false;
+	float slowdown = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && std::strcmp(argv[i], "--baseline") == 0)		{ baselinePath = argv[++i]; }
+		else if (i + 1 < argc && std::strcmp(argv[i], "--scopes") == 0)		{ scopesPath = argv[++i]; }
+		else if (i + 1 < argc && std::strcmp(argv[i], "--replay") == 0)		{ replayPath = argv[++i]; }
+		else if (i + 1 < argc && std::strcmp(argv[i], "--tolerance") == 0)	{ tolerance = (float)std::atof(argv[++i]); }
+		else if (std::strcmp(argv[i], "--update") == 0)						{ update = true; }
+		else if (std::strcmp(argv[i], "--create") == 0)						{ update = create = true; }
+		else if (std::strcmp(argv[i], "--assert-zero-allocs") == 0)			{ assertZeroAllocs = true; }
+		else if (i + 1 < argc && std::strcmp(argv[i], "--slowdown") == 0)	{ slowdown = std::max((float)std::atof(argv[++i]), 1.0f); }
+		else
+		{
+			std::fprintf(stderr, "usage: FrameBudgetTest [--baseline frame_budget.txt] [--scopes scopes.txt] [--replay session.rec] [--tolerance percent] [--update | --create] [--assert-zero-allocs] [--slowdown factor]\n");
+			return 2;
+		}
+	}
+
+	if (assertZeroAllocs)
+	{
+		{
+			// the level as it ships, the crowd only adds entities, not new kinds of work
+			BudgetEngine engine("assets.txt");
+			if (!replayPath.empty() && !engine.replay(replayPath)) { return 2; }
+			engine.m_levelPath = LevelPath;
+			engine.m_assertZeroAllocs = true;
+			engine.runScenario();
+		}
+
+		size_t violations = Profiler::Instance().allocations().violations();
+		if (violations > 0)
+		{
+			std::printf("%zu frames allocated after the warmup, see the report above\n", violations);
+			return 1;
+		}
+		std::printf("No frame allocated after the warmup\n");
+		return 0;
+	}
+
+	std::string machine = ThisMachine();
+	Baseline baseline;
+	bool found = LoadBaseline(baselinePath, baseline);
+	if (create && found && baseline.measured == machine)
+	{
+		std::printf("Baseline at %s was measured on this machine and build\n", baselinePath.c_str());
+		return 0;
+	}
+	if (!found && !update)
+	{
+		std::fprintf(stderr, "No baseline at %s, create one with --update\n", baselinePath.c_str());
+		return 2;
+	}
+
+	// a fresh or stale baseline starts over from the scope list
+	if (update && (!found || baseline.measured != machine) && !scopesPath.empty())
+	{
+		baseline = Baseline();
+		if (!LoadBaseline(scopesPath, baseline))
+		{
+			std::fprintf(stderr, "No scope list at %s\n", scopesPath.c_str());
+			return 2;
+		}
+	}
+	if (baseline.budgets.empty())
+	{
+		for (const char* scope : DefaultScopes) { baseline.budgets.push_back({ scope }); }
+	}
+
+	if (!update)
+	{
+		for (auto& budget : baseline.budgets)
+		{
+			if (budget.milliseconds < 0)
+			{
+				std::fprintf(stderr, "%s only lists the scopes, measure them with --update\n", baselinePath.c_str());
+				return 2;
+			}
+		}
+		if (baseline.measured != machine)
+		{
+			std::fprintf(stderr, "warning: the baseline was measured on %s, this is %s\n", baseline.measured.c_str(), machine.c_str());
+		}
+	}
+
+	std::string levelPath;
+	if (replayPath.empty())
+	{
+		levelPath = WriteCrowdLevel();
+		if (levelPath.empty())
+		{
+			std::fprintf(stderr, "Could not write the scenario level from %s\n", LevelPath);
+			return 2;
+		}
+	}
+
+	// every scope's average of each run, sorted afterwards, empty for a scope that never ran
+	std::vector<std::vector<float>> runs(baseline.budgets.size());
+	std::vector<float> worst(baseline.budgets.size(), 0.0f);
+	for (size_t run = 0; run < Runs; run++)
+	{
+		{
+			BudgetEngine engine("assets.txt");
+			if (!replayPath.empty() && !engine.replay(replayPath)) { return 2; }
+			engine.m_levelPath = levelPath;
+			engine.m_slowdown = slowdown;
+			engine.runScenario();
+		}
+
+		for (size_t b = 0; b < baseline.budgets.size(); b++)
+		{
+			ProfileStats::Summary summary;
+			if (!FindScope(baseline.budgets[b].scope, summary)) { continue; }
+			runs[b].push_back(summary.runAverage);
+			worst[b] = std::max(worst[b], summary.worst);
+		}
+
+		// the next run's warmup starts the stats over
+		Profiler::Instance().enableStats(false);
+	}
+	for (auto& scope : runs) { std::sort(scope.begin(), scope.end()); }
+
+	if (update)
+	{
+		for (size_t b = 0; b < baseline.budgets.size(); b++)
+		{
+			baseline.budgets[b].milliseconds = runs[b].empty() ? 0 : runs[b][runs[b].size() / 2];
+		}
+		baseline.measured = machine;
+
+		if (!SaveBaseline(baselinePath, baseline))
+		{
+			std::fprintf(stderr, "Could not write: %s\n", baselinePath.c_str());
+			return 2;
+		}
+		std::printf("Baseline for %s written to %s\n", machine.c_str(), baselinePath.c_str());
+		return 0;
+	}
+	// the per system diff, every scope is printed so a failure shows what moved around it
+	int failed = 0;
+	std::printf("%-20s %10s %10s %10s %8s %10s\n", "scope", "baseline", "allowed", "measured", "diff", "worst");
+	for (size_t b = 0; b < baseline.budgets.size(); b++)
+	{
+		const Budget& budget = baseline.budgets[b];
+		float percent = tolerance >= 0 ? tolerance : budget.tolerance;
+		float allowed = budget.milliseconds + std::max(budget.milliseconds * percent / 100, baseline.floor);
+
+		if (runs[b].empty())
+		{
+			std::printf("%-20s %10.4f %10.4f %10s %8s %10s  MISSING\n", budget.scope.c_str(), budget.milliseconds, allowed, "-", "-", "-");
+			failed++;
+			continue;
+		}
+
+		float measured = runs[b][runs[b].size() / 2];
+		float diff = budget.milliseconds > 0 ? (measured / budget.milliseconds - 1) * 100 : 0;
+		bool over = measured > allowed;
+		std::printf("%-20s %10.4f %10.4f %10.4f %+7.1f%% %10.4f  %s\n", budget.scope.c_str(), budget.milliseconds, allowed,
+			measured, diff, worst[b], over ? "OVER BUDGET" : "ok");
+		failed += over ? 1 : 0;
+	}
+
+	if (failed > 0)
+	{
+		std::printf("%d of %zu systems over budget\n", failed, baseline.budgets.size());
+		return 1;
+	}
+
+	std::printf("All %zu systems within budget\n", baseline.budgets.size());
+	return 0;
+}